@@ -0,0 +1,215 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#include "SECompressionDictionary.h"
+
+#include "SEFileHelpers.h"
+#include "SaveExtension.h"
+
+#include <Hash/xxhash.h>
+#include <Misc/ScopeLock.h>
+
+
+// Length of the sequences of bytes counted while training
+static const int32 SE_DICTIONARY_DMER_SIZE = 8;
+// Length of the segments of samples that form the dictionary
+static const int32 SE_DICTIONARY_SEGMENT_SIZE = 128;
+
+static FCriticalSection DictionariesLock;
+static TMap<uint32, TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe>> Dictionaries;
+
+
+void USECompressionDictionary::PostLoad()
+{
+	Super::PostLoad();
+	Register();
+}
+
+void USECompressionDictionary::TrainFromSaveFolder()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(USECompressionDictionary::TrainFromSaveFolder);
+	const int64 MaxSamplesSize = int64(FMath::Max(MaxSampleSize, 1)) * 1024 * 1024;
+
+	TArray<FString> SlotNames;
+	FSEFileHelpers::FindAllFilesSync(SlotNames);
+
+	TArray<TArray<uint8>> Samples;
+	int64 SamplesSize = 0;
+	for (const FString& SlotName : SlotNames)
+	{
+		FScopedFileReader Reader(FSEFileHelpers::GetSlotPath(SlotName));
+		if (!Reader.IsValid())
+		{
+			continue;
+		}
+		FSaveFile File;
+		File.Read(Reader, true);
+		for (FSaveFileChunk& Chunk : File.Chunks)
+		{
+			if (Chunk.Type != ESaveFileChunkType::Level || SamplesSize >= MaxSamplesSize)
+			{
+				continue;
+			}
+			TArray64<uint8> Sample;
+			if (FSaveFile::ReadChunk(Reader, Chunk) && Chunk.Decompress(Sample) && Sample.Num() > 0 &&
+				Sample.Num() <= MAX_int32)
+			{
+				SamplesSize += Sample.Num();
+				Samples.Emplace(Sample);
+			}
+			Chunk.Bytes.Empty();
+		}
+	}
+
+	if (!Train(Samples))
+	{
+		UE_LOG(LogSaveExtension, Warning,
+			TEXT("Compression dictionary '%s' could not be trained from %i levels of %i save files"), *GetName(),
+			Samples.Num(), SlotNames.Num());
+		return;
+	}
+	UE_LOG(LogSaveExtension, Log, TEXT("Trained compression dictionary '%s' (%i bytes) from %i levels"),
+		*GetName(), Bytes.Num(), Samples.Num());
+	MarkPackageDirty();
+}
+
+bool USECompressionDictionary::Train(TConstArrayView<TArray<uint8>> Samples)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(USECompressionDictionary::Train);
+	constexpr int32 DmerSize = SE_DICTIONARY_DMER_SIZE;
+	constexpr int32 SegmentSize = SE_DICTIONARY_SEGMENT_SIZE;
+
+	// Sequences of bytes are counted on every sample, so that segments are scored by how often their content
+	// repeats between and within levels
+	TMap<uint64, int32> Frequencies;
+	for (const TArray<uint8>& Sample : Samples)
+	{
+		for (int32 i = 0; i + DmerSize <= Sample.Num(); ++i)
+		{
+			uint64 Dmer;
+			FMemory::Memcpy(&Dmer, Sample.GetData() + i, DmerSize);
+			++Frequencies.FindOrAdd(Dmer);
+		}
+	}
+	auto GetScore = [&Frequencies](const uint8* Data) {
+		uint64 Dmer;
+		FMemory::Memcpy(&Dmer, Data, DmerSize);
+		const int32* Frequency = Frequencies.Find(Dmer);
+		// Content seen once doesn't help compression
+		return Frequency && *Frequency > 1 ? int64(*Frequency) : 0ll;
+	};
+
+	// The samples are split in as many epochs as segments fit in the dictionary, and the best segment of each
+	// epoch is selected
+	struct FSegment
+	{
+		const uint8* Data = nullptr;
+		int64 Score = 0;
+	};
+	TArray<FSegment> Segments;
+	const int32 NumEpochs = MaxSize / SegmentSize;
+	int64 TotalSize = 0;
+	for (const TArray<uint8>& Sample : Samples)
+	{
+		TotalSize += Sample.Num();
+	}
+	const int64 EpochSize = FMath::Max<int64>(TotalSize / NumEpochs, SegmentSize);
+
+	int32 SampleIndex = 0;
+	int32 SampleOffset = 0;
+	while (SampleIndex < Samples.Num() && Segments.Num() < NumEpochs)
+	{
+		// Best segment in the next EpochSize bytes. Segments don't cross samples
+		FSegment Best;
+		int64 Remaining = EpochSize;
+		while (Remaining > 0 && SampleIndex < Samples.Num())
+		{
+			const TArray<uint8>& Sample = Samples[SampleIndex];
+			const int32 End = int32(FMath::Min<int64>(Sample.Num(), SampleOffset + Remaining));
+			if (End - SampleOffset >= SegmentSize)
+			{
+				const uint8* Data = Sample.GetData();
+				int64 Score = 0;
+				for (int32 i = SampleOffset; i <= SampleOffset + SegmentSize - DmerSize; ++i)
+				{
+					Score += GetScore(Data + i);
+				}
+				for (int32 Start = SampleOffset;; ++Start)
+				{
+					if (Score > Best.Score)
+					{
+						Best = {Data + Start, Score};
+					}
+					if (Start + SegmentSize >= End)
+					{
+						break;
+					}
+					// Slide the window one byte
+					Score += GetScore(Data + Start + SegmentSize - DmerSize + 1) - GetScore(Data + Start);
+				}
+			}
+			Remaining -= End - SampleOffset;
+			SampleOffset = End;
+			if (SampleOffset >= Sample.Num())
+			{
+				++SampleIndex;
+				SampleOffset = 0;
+			}
+		}
+
+		if (Best.Data)
+		{
+			Segments.Add(Best);
+			// Its content is in the dictionary already
+			for (int32 i = 0; i <= SegmentSize - DmerSize; ++i)
+			{
+				uint64 Dmer;
+				FMemory::Memcpy(&Dmer, Best.Data + i, DmerSize);
+				Frequencies.Remove(Dmer);
+			}
+		}
+	}
+
+	if (Segments.IsEmpty())
+	{
+		return false;
+	}
+
+	// Zlib references recent history with fewer bits. The best segments go last
+	Segments.Sort([](const FSegment& A, const FSegment& B) {
+		return A.Score < B.Score;
+	});
+	Bytes.Reset(Segments.Num() * SegmentSize);
+	for (const FSegment& Segment : Segments)
+	{
+		Bytes.Append(Segment.Data, SegmentSize);
+	}
+
+	Id = int32(uint32(FXxHash64::HashBuffer(Bytes.GetData(), Bytes.Num()).Hash));
+	if (Id == 0)
+	{
+		// 0 means no dictionary
+		Id = 1;
+	}
+	Register();
+	return true;
+}
+
+void USECompressionDictionary::Register() const
+{
+	if (Id == 0 || Bytes.IsEmpty())
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&DictionariesLock);
+	if (!Dictionaries.Contains(GetId()))
+	{
+		Dictionaries.Add(GetId(), MakeShared<const TArray<uint8>, ESPMode::ThreadSafe>(Bytes));
+	}
+}
+
+TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> USECompressionDictionary::Find(uint32 DictionaryId)
+{
+	FScopeLock ScopeLock(&DictionariesLock);
+	return Dictionaries.FindRef(DictionaryId);
+}
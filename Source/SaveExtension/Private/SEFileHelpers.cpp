@@ -2,25 +2,38 @@
 
 #include "SEFileHelpers.h"
 
+#include "SECompressionDictionary.h"
+#include "SESlotCatalog.h"
 #include "SaveExtension.h"
 #include "SaveManager.h"
 #include "SaveSlot.h"
 #include "SaveSlotData.h"
 #include "Serialization/SEArchive.h"
+#include "Serialization/SEBlockArchive.h"
 
+#include <Async/ParallelFor.h>
 #include <HAL/PlatformFile.h>
 #include <HAL/PlatformFileManager.h>
+#include <HAL/PlatformProcess.h>
+#include <Hash/xxhash.h>
+#include <Misc/Guid.h>
+#include <Misc/ScopeLock.h>
 #include <SaveGameSystem.h>
 #include <Serialization/ArchiveLoadCompressedProxy.h>
-#include <Serialization/ArchiveSaveCompressedProxy.h>
 #include <Serialization/MemoryReader.h>
 #include <Serialization/MemoryWriter.h>
 #include <Tasks/Pipe.h>
 #include <UObject/Package.h>
 #include <UObject/UObjectGlobals.h>
+#include <atomic>
 
 
 static const int SE_SAVEGAME_FILE_TYPE_TAG = 0x0001;	// "sAvG"
+// Entries of a journal are the stored bytes of changed chunks followed by a table with all chunks
+static const int32 SE_JOURNAL_CHUNK_TAG = 0x53454A43;	// "SEJC"
+static const int32 SE_JOURNAL_TABLE_TAG = 0x53454A54;	// "SEJT"
+// Blobs are the stored bytes of a chunk after this tag
+static const int32 SE_BLOB_TAG = 0x5345426C;	// "SEBl"
 
 UE::Tasks::FPipe BackendPipe{TEXT("SaveExtensionPipe")};
 
@@ -30,6 +43,8 @@ class FSEFindSlotVisitor : public IPlatformFile::FDirectoryVisitor
 {
 public:
 	TArray<FString>& FoundSlots;
+	/** Slots with a temporary file left behind by an interrupted save. Recovered once listing finishes */
+	TArray<FString> Interrupted;
 
 	FSEFindSlotVisitor(TArray<FString>& FoundSlots) : FoundSlots(FoundSlots) {}
 	virtual bool Visit(const TCHAR* FilenameOrDirectory, bool bIsDirectory) override
@@ -47,7 +62,13 @@ public:
 		FPaths::Split(FullFilePath, Folder, Filename, Extension);
 		if (Extension == TEXT("sav"))
 		{
-			FoundSlots.Add(Filename);
+			FoundSlots.AddUnique(Filename);
+		}
+		else if (Extension == TEXT("tmp") && Filename.EndsWith(TEXT(".sav")))
+		{
+			// Left behind by an interrupted save
+			Filename.LeftChopInline(4);
+			Interrupted.AddUnique(Filename);
 		}
 		return true;
 	}
@@ -61,6 +82,42 @@ struct FSaveGameFileVersion
 		InitialVersion = 1,
 		// serializing custom versions into the savegame data to handle that type of versioning
 		AddedCustomVersions = 2,
+		// slot data is split in independently compressed chunks indexed by a table of contents
+		AddedChunks = 3,
+		// codec and level are stored in the header and each chunk
+		AddedCompressionCodecs = 4,
+		// save date is stored next to the slot info
+		AddedSaveDate = 5,
+		// chunks store their own version. Levels store names in a table referenced by index
+		AddedLevelTables = 6,
+		// levels also store classes and object paths in a table
+		AddedLevelObjectTables = 7,
+		// objects of the level table can be records of that level
+		AddedLevelRecordRefs = 8,
+		// checksums of the header, the table of contents and each chunk
+		AddedChecksums = 9,
+		// chunks can store only the blocks that changed since the previous version of the file
+		AddedDeltaChunks = 10,
+		// chunks can be stored in the blob store shared by all slots
+		AddedBlobStore = 11,
+		// levels store byte-identical data of their records once
+		AddedLevelPayloads = 12,
+		// level records can be grouped by class, with a stream for each of their fields
+		AddedRecordLayouts = 13,
+		// transforms and velocities of grouped level records are stored in a column that can be quantized
+		AddedTransformColumns = 14,
+		// streaming level chunks can be compressed with a trained dictionary
+		AddedCompressionDictionaries = 15,
+		// streams of grouped level records store 64-bit sizes
+		AddedLargeRecordStreams = 16,
+		// chunks can be encrypted
+		AddedEncryptedChunks = 17,
+		// data of level records can store only the properties planned for their class
+		AddedClassPlans = 18,
+		// chunks store a checksum of their bytes before compression
+		AddedRawChunkHashes = 19,
+		// encrypted chunks use counter mode and authenticate each block
+		AddedAuthenticatedEncryption = 20,
 
 		// -----<new versions can be added above this line>-------------------------------------------------
 		VersionPlusOne,
@@ -68,23 +125,345 @@ struct FSaveGameFileVersion
 	};
 };
 
-FScopedFileWriter::FScopedFileWriter(FStringView Filename, int32 Flags)
+/** File version in which each format of level tables was added. Indexed by ESELevelTables */
+static constexpr int32 LevelTablesVersions[] = {
+	FSaveGameFileVersion::AddedSaveDate,
+	FSaveGameFileVersion::AddedLevelTables,
+	FSaveGameFileVersion::AddedLevelObjectTables,
+	FSaveGameFileVersion::AddedLevelRecordRefs,
+	FSaveGameFileVersion::AddedLevelPayloads,
+	FSaveGameFileVersion::AddedRecordLayouts,
+	FSaveGameFileVersion::AddedTransformColumns,
+	FSaveGameFileVersion::AddedLargeRecordStreams,
+	FSaveGameFileVersion::AddedClassPlans,
+};
+static_assert(UE_ARRAY_COUNT(LevelTablesVersions) == int32(ESELevelTables::Latest) + 1,
+	"Each format of level tables needs the file version that added it");
+
+/** @return the version a level chunk is stored with, so that it is read back in the same format */
+static int32 GetLevelTablesVersion(ESELevelTables Tables)
+{
+	return LevelTablesVersions[int32(Tables)];
+}
+
+/** @return the format of level tables stored by a chunk of this version */
+static ESELevelTables GetLevelTables(int32 ChunkVersion)
+{
+	for (int32 i = int32(ESELevelTables::Latest); i > 0; --i)
+	{
+		if (ChunkVersion >= LevelTablesVersions[i])
+		{
+			return ESELevelTables(i);
+		}
+	}
+	return ESELevelTables::None;
+}
+
+static FString GetJournalPath(FStringView FilePath)
+{
+	return FString::Printf(TEXT("%s.log"), FilePath.GetData());
+}
+
+static FString GetDeltaBasePath(FStringView SlotName, int32 Depth)
+{
+	return FString::Printf(TEXT("%s.base%d"), *FSEFileHelpers::GetSlotPath(SlotName), Depth);
+}
+
+/** Deletes the previous versions of a slot kept by delta saves */
+static void DeleteDeltaBases(FStringView SlotName)
+{
+	TArray<FString> BaseFiles;
+	const FString Wildcard = FSEFileHelpers::GetSlotPath(SlotName) + TEXT(".base*");
+	IFileManager::Get().FindFiles(BaseFiles, *Wildcard, true, false);
+	for (const FString& BaseFile : BaseFiles)
+	{
+		IFileManager::Get().Delete(*(FSEFileHelpers::GetSaveFolder() / BaseFile), false, false, true);
+	}
+}
+
+/** Records of spilled levels whose spill file is being written. Kept if writing it fails, and read from here
+ * instead of the file
+ */
+static FCriticalSection SpilledLevelsLock;
+static TMap<FString, TSharedPtr<FStreamingLevelRecord, ESPMode::ThreadSafe>> SpilledLevels;
+
+static TSharedPtr<FStreamingLevelRecord, ESPMode::ThreadSafe> FindSpilledLevel(const FString& SpillPath, bool bRemove)
+{
+	FScopeLock ScopeLock(&SpilledLevelsLock);
+	TSharedPtr<FStreamingLevelRecord, ESPMode::ThreadSafe> Level;
+	if (bRemove)
+	{
+		SpilledLevels.RemoveAndCopyValue(SpillPath, Level);
+		return Level;
+	}
+	return SpilledLevels.FindRef(SpillPath);
+}
+
+/** Copies the settings of a slot that files are written with */
+static void ApplySlotSettings(FSaveFile& File, const USaveSlot* Slot)
+{
+	File.CompressionCodec = Slot->CompressionCodec;
+	File.CompressionLevel = Slot->CompressionLevel;
+	if (const USECompressionDictionary* Dictionary = Slot->CompressionDictionary)
+	{
+		Dictionary->Register();
+		File.CompressionDictionaryId = Dictionary->GetId();
+	}
+	File.bGroupRecordsByClass = Slot->bGroupRecordsByClass;
+	if (Slot->bEncryptFiles)
+	{
+		File.EncryptionKey = FSEFileHelpers::GetEncryptionKey();
+	}
+	if (Slot->bQuantizeTransforms)
+	{
+		File.TransformPositionBits = uint8(FMath::Clamp(Slot->TransformPositionBits, 1, 24));
+		File.TransformRotationBits = uint8(FMath::Clamp(Slot->TransformRotationBits, 1, 16));
+	}
+}
+
+/** Writes the stored bytes of a chunk into the blob store unless they are already there */
+static bool StoreBlob(const FIoHash& Hash, TConstArrayView64<uint8> StoredBytes, ESEFileDurability Durability)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(StoreBlob);
+	const FString BlobPath = FSEFileHelpers::GetBlobPath(Hash);
+	if (IFileManager::Get().FileSize(*BlobPath) == int64(sizeof(SE_BLOB_TAG)) + StoredBytes.Num())
+	{
+		return true;
+	}
+
+	// Renamed once complete, so that an interrupted write never leaves a blob that looks valid
+	const FString TempBlobPath = BlobPath + TEXT(".tmp");
+	{
+		FScopedFileWriter Writer(TempBlobPath);
+		if (!Writer.IsValid())
+		{
+			return false;
+		}
+		int32 Tag = SE_BLOB_TAG;
+		Writer.GetArchive() << Tag;
+		Writer.GetArchive().Serialize(const_cast<uint8*>(StoredBytes.GetData()), StoredBytes.Num());
+		if (!Writer.Close(Durability))
+		{
+			IFileManager::Get().Delete(*TempBlobPath, false, true, true);
+			return false;
+		}
+	}
+	return IFileManager::Get().Move(*BlobPath, *TempBlobPath, true, true, false, true);
+}
+
+struct FSEStoredBlock
+{
+	int64 Offset = 0;
+	int32 Size = 0;
+};
+
+/** Splits the stored bytes of a chunk in the blocks written by FSEBlockWriter.
+ * Uncompressed chunks have no block headers, so they are split every BlockSize bytes.
+ */
+static void GetStoredBlocks(
+	TConstArrayView64<uint8> StoredBytes, bool bCompressed, TArray<FSEStoredBlock>& OutBlocks)
+{
+	int64 Offset = 0;
+	while (Offset < StoredBytes.Num())
+	{
+		const int64 Remaining = StoredBytes.Num() - Offset;
+		int64 Size = FMath::Min<int64>(FSEBlockWriter::BlockSize, Remaining);
+		int32 Header[2]{};
+		if (bCompressed && Remaining >= int32(sizeof(Header)))
+		{
+			// Compressed blocks start with their stored and raw sizes
+			FMemory::Memcpy(Header, StoredBytes.GetData() + Offset, sizeof(Header));
+			Size = FMath::Clamp(int64(sizeof(Header)) + Header[0], int64(sizeof(Header)), Remaining);
+		}
+		OutBlocks.Add({Offset, int32(Size)});
+		Offset += Size;
+	}
+}
+
+/** Encodes the stored bytes of a chunk as the blocks that are not in its base.
+ * Each block is either an offset into the base or INDEX_NONE followed by the bytes of the block.
+ * Offsets are 32-bit, so blocks further than 2GB into the base are stored again.
+ */
+static void EncodeDelta(TConstArrayView64<uint8> StoredBytes, TConstArrayView64<uint8> BaseBytes,
+	bool bCompressed, TArray64<uint8>& OutDelta)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(EncodeDelta);
+	TArray<FSEStoredBlock> BaseBlocks;
+	GetStoredBlocks(BaseBytes, bCompressed, BaseBlocks);
+	TMap<uint64, int32> BaseBlocksByHash;
+	BaseBlocksByHash.Reserve(BaseBlocks.Num());
+	for (int32 Index = 0; Index < BaseBlocks.Num(); ++Index)
+	{
+		const FSEStoredBlock& Block = BaseBlocks[Index];
+		if (Block.Offset > MAX_int32)
+		{
+			break;
+		}
+		BaseBlocksByHash.FindOrAdd(FXxHash64::HashBuffer(BaseBytes.GetData() + Block.Offset, Block.Size).Hash, Index);
+	}
+
+	TArray<FSEStoredBlock> Blocks;
+	GetStoredBlocks(StoredBytes, bCompressed, Blocks);
+	FMemoryWriter64 DeltaAr{OutDelta};
+	for (const FSEStoredBlock& Block : Blocks)
+	{
+		const uint8* BlockData = StoredBytes.GetData() + Block.Offset;
+		int32 BaseOffset = INDEX_NONE;
+		const int32* BaseIndex = BaseBlocksByHash.Find(FXxHash64::HashBuffer(BlockData, Block.Size).Hash);
+		if (BaseIndex)
+		{
+			const FSEStoredBlock& BaseBlock = BaseBlocks[*BaseIndex];
+			if (BaseBlock.Size == Block.Size &&
+				FMemory::Memcmp(BaseBytes.GetData() + BaseBlock.Offset, BlockData, Block.Size) == 0)
+			{
+				BaseOffset = int32(BaseBlock.Offset);
+			}
+		}
+
+		int32 Size = Block.Size;
+		DeltaAr << BaseOffset;
+		DeltaAr << Size;
+		if (BaseOffset == INDEX_NONE)
+		{
+			DeltaAr.Serialize(const_cast<uint8*>(BlockData), Size);
+		}
+	}
+}
+
+static bool DecodeDelta(
+	TConstArrayView64<uint8> DeltaBytes, TConstArrayView64<uint8> BaseBytes, TArray64<uint8>& OutStored)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(DecodeDelta);
+	OutStored.Reset();
+	FMemoryReaderView DeltaAr{MakeMemoryView(DeltaBytes)};
+	while (DeltaAr.Tell() < DeltaAr.TotalSize())
+	{
+		int32 BaseOffset = INDEX_NONE;
+		int32 Size = 0;
+		DeltaAr << BaseOffset;
+		DeltaAr << Size;
+		if (DeltaAr.IsError() || Size < 0)
+		{
+			return false;
+		}
+
+		if (BaseOffset == INDEX_NONE)
+		{
+			if (DeltaAr.Tell() + Size > DeltaAr.TotalSize())
+			{
+				return false;
+			}
+			const int64 Start = OutStored.AddUninitialized(Size);
+			DeltaAr.Serialize(OutStored.GetData() + Start, Size);
+		}
+		else
+		{
+			if (BaseOffset < 0 || int64(BaseOffset) + Size > BaseBytes.Num())
+			{
+				return false;
+			}
+			OutStored.Append(BaseBytes.GetData() + BaseOffset, Size);
+		}
+	}
+	return !DeltaAr.IsError();
+}
+
+/** Rebuilds the stored bytes of a delta chunk from the same chunk of its base file */
+static bool RebuildDeltaChunk(FSaveFileChunk& Chunk)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(RebuildDeltaChunk);
+
+	// Chains are bound by the slot settings. This only stops files that end up depending on themselves
+	static thread_local int32 Depth = 0;
+	if (Depth > 64)
+	{
+		return false;
+	}
+	TGuardValue<int32> DepthGuard(Depth, Depth + 1);
+
+	FScopedFileReader BaseReader(Chunk.DeltaBaseFile);
+	if (!BaseReader.IsValid())
+	{
+		return false;
+	}
+	FSaveFile Base{};
+	Base.Read(BaseReader, true);
+	FSaveFileChunk* BaseChunk = Base.FindChunk(Chunk.Type, Chunk.Name);
+	TArray64<uint8> StoredBytes;
+	if (!BaseChunk || !FSaveFile::ReadChunk(BaseReader, *BaseChunk) ||
+		!DecodeDelta(Chunk.Bytes, BaseChunk->Bytes, StoredBytes))
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Chunk '%s' could not be rebuilt from '%s'"), *Chunk.Name,
+			*Chunk.DeltaBaseFile);
+		return false;
+	}
+
+	Chunk.Bytes = MoveTemp(StoredBytes);
+	Chunk.Size = Chunk.Bytes.Num();
+	Chunk.bDelta = false;
+	Chunk.DeltaBaseFile.Reset();
+	return true;
+}
+
+/** Serializes the records of a level chunk in the format of its version */
+static void SerializeLevelChunk(FArchive& Ar, FLevelRecord& Level, int32 ChunkVersion)
+{
+	Level.Tables = GetLevelTables(ChunkVersion);
+	if (Level.Tables != ESELevelTables::None)
+	{
+		Level.SerializeWithTables(Ar);
+	}
+	else
+	{
+		Level.Serialize(Ar);
+	}
+}
+
+FScopedFileWriter::FScopedFileWriter(FStringView InFilename, int32 Flags) : Filename(InFilename)
 {
 	if (!Filename.IsEmpty())
 	{
-		Writer = IFileManager::Get().CreateFileWriter(Filename.GetData(), Flags);
+		Writer = IFileManager::Get().CreateFileWriter(*Filename, Flags);
+	}
+}
+
+bool FScopedFileWriter::Close(ESEFileDurability Durability)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FScopedFileWriter::Close);
+	if (!Writer)
+	{
+		return false;
+	}
+
+	if (Durability != ESEFileDurability::None)
+	{
+		Writer->Flush();
 	}
+	Writer->Close();
+	const bool bSuccess = !IsError();
+	delete Writer;
+	Writer = nullptr;
+
+	if (bSuccess && Durability == ESEFileDurability::FullFlush)
+	{
+		// File archives don't expose a full flush. Ask the OS through a new handle to the same file
+		TUniquePtr<IFileHandle> Handle{
+			FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename, true, false)};
+		return Handle && Handle->Flush(true);
+	}
+	return bSuccess;
 }
 
-FScopedFileReader::FScopedFileReader(FStringView Filename, int32 Flags)
-	: ScopedLoadingState(Filename.GetData())
+FScopedFileReader::FScopedFileReader(FStringView InFilename, int32 Flags)
+	: ScopedLoadingState(InFilename.GetData())
+	, Filename(InFilename)
 {
 	if (!Filename.IsEmpty())
 	{
-		Reader = IFileManager::Get().CreateFileReader(Filename.GetData(), Flags);
+		Reader = IFileManager::Get().CreateFileReader(*Filename, Flags);
 		if (!Reader && !(Flags & FILEREAD_Silent))
 		{
-			UE_LOG(LogSaveExtension, Warning, TEXT("Failed to read file '%s' error."), Filename.GetData());
+			UE_LOG(LogSaveExtension, Warning, TEXT("Failed to read file '%s' error."), *Filename);
 		}
 	}
 }
@@ -112,6 +491,11 @@ bool FSaveFile::IsEmpty() const
 	return FileTypeTag == 0;
 }
 
+bool FSaveFile::IsChunked() const
+{
+	return SaveGameFileVersion >= FSaveGameFileVersion::AddedChunks;
+}
+
 void FSaveFile::Read(FScopedFileReader& Reader, bool bSkipData)
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::Read);
@@ -148,9 +532,95 @@ void FSaveFile::Read(FScopedFileReader& Reader, bool bSkipData)
 
 	Ar << ClassName;
 	Ar << Bytes;
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedSaveDate)
+	{
+		Ar << SaveDate;
+	}
 
 	Ar << DataClassName;
-	if (bSkipData || DataClassName.IsEmpty())
+	if (DataClassName.IsEmpty())
+	{
+		return;
+	}
+
+	if (IsChunked())
+	{
+		if (SaveGameFileVersion >= FSaveGameFileVersion::AddedCompressionCodecs)
+		{
+			Ar << CompressionCodec;
+			Ar << CompressionLevel;
+		}
+		else
+		{
+			CompressionCodec = ESECompressionCodec::Zlib;
+		}
+		if (SaveGameFileVersion >= FSaveGameFileVersion::AddedCompressionDictionaries)
+		{
+			Ar << CompressionDictionaryId;
+		}
+
+		const int64 HeaderSize = Ar.Tell();
+		int64 TocOffset = 0;
+		Ar << TocOffset;
+		if (TocOffset <= 0 || TocOffset >= Ar.TotalSize())
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Save file is incomplete. Its table of contents is missing"));
+			return;
+		}
+		Ar.Seek(TocOffset);
+		if (SaveGameFileVersion < FSaveGameFileVersion::AddedChecksums)
+		{
+			SerializeTable(Ar);
+		}
+		else if (!ReadVerifiedTable(Ar, TocOffset) || !VerifyHeader(Ar, HeaderSize))
+		{
+			bCorrupted = true;
+			Chunks.Empty();
+			return;
+		}
+		else
+		{
+			ReadJournal(GetJournalPath(Reader.GetFilename()));
+		}
+
+		for (FSaveFileChunk& Chunk : Chunks)
+		{
+			if (Chunk.bDelta)
+			{
+				Chunk.DeltaBaseFile = FPaths::GetPath(Reader.GetFilename()) / DeltaBaseName;
+			}
+		}
+
+		if (!bSkipData)
+		{
+			TArray<FSaveFileChunk*, TInlineAllocator<8>> ReadChunks;
+			for (FSaveFileChunk& Chunk : Chunks)
+			{
+				// Levels are mapped or decompressed straight from the file when deserialized
+				if (Chunk.Type != ESaveFileChunkType::Level && Chunk.Type != ESaveFileChunkType::Thumbnail)
+				{
+					if (ReadChunk(Reader, Chunk, false))
+					{
+						ReadChunks.Add(&Chunk);
+					}
+				}
+			}
+
+			// Checked before anything is deserialized
+			TRACE_CPUPROFILER_EVENT_SCOPE(VerifyChunks);
+			std::atomic<bool> bAllValid{true};
+			ParallelFor(ReadChunks.Num(), [&ReadChunks, &bAllValid](int32 Index) {
+				if (!ReadChunks[Index]->Verify(ReadChunks[Index]->Bytes))
+				{
+					bAllValid = false;
+				}
+			});
+			bCorrupted = !bAllValid;
+		}
+		return;
+	}
+
+	if (bSkipData)
 	{
 		return;
 	}
@@ -179,131 +649,1290 @@ void FSaveFile::Read(FScopedFileReader& Reader, bool bSkipData)
 	}
 }
 
-void FSaveFile::Write(FScopedFileWriter& Writer, bool bCompressData)
+bool FSaveFile::ReadVerifiedTable(FArchive& Ar, int64 TocOffset)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::Write);
-
-	bIsDataCompressed = bCompressData;
-	FArchive& Ar = Writer.GetArchive();
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::ReadVerifiedTable);
 
-	{	 // Header information
-		Ar << FileTypeTag;
-		Ar << SaveGameFileVersion;
-		Ar << PackageFileUEVersion;
-		Ar << SavedEngineVersion;
-		Ar << CustomVersionFormat;
-		CustomVersions.Serialize(
-			Ar, static_cast<ECustomVersionSerializationFormat::Type>(CustomVersionFormat));
+	// The table is followed by its own checksum
+	const int64 TableSize = Ar.TotalSize() - TocOffset - int64(sizeof(uint64));
+	if (TableSize <= 0)
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Save file is corrupted. Its table of contents is truncated"));
+		return false;
 	}
 
-	Ar << ClassName;
-	Ar << Bytes;
-
-	Ar << DataClassName;
-	if (!DataClassName.IsEmpty())
+	TArray<uint8> TableBytes;
+	TableBytes.SetNumUninitialized(int32(TableSize));
+	Ar.Serialize(TableBytes.GetData(), TableSize);
+	Ar << TableHash;
+	if (Ar.IsError() || FXxHash64::HashBuffer(TableBytes.GetData(), TableSize).Hash != TableHash)
 	{
-		Ar << bIsDataCompressed;
-		if (bIsDataCompressed)
-		{
-			TArray<uint8> CompressedDataBytes;
-			{	 // Compression
-				TRACE_CPUPROFILER_EVENT_SCOPE(Compression);
-				// Compress Object data
-				FArchiveSaveCompressedProxy Compressor(CompressedDataBytes, NAME_Zlib);
-				Compressor << DataBytes;
-				Compressor.Close();
-			}
-			Ar << CompressedDataBytes;
-		}
-		else
-		{
-			Ar << DataBytes;
-		}
+		UE_LOG(LogSaveExtension, Warning, TEXT("Save file is corrupted. Its table of contents doesn't match its checksum"));
+		return false;
 	}
-	Ar.Close();
-}
-
-void FSaveFile::SerializeInfo(USaveSlot* Slot)
-{
-	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::SerializeInfo);
-	check(Slot);
-	Bytes.Reset();
-	ClassName = Slot->GetClass()->GetPathName();
-
-	FMemoryWriter BytesWriter(Bytes);
-	FObjectAndNameAsStringProxyArchive Ar(BytesWriter, false);
-	Slot->Serialize(Ar);
-}
-void FSaveFile::SerializeData(USaveSlotData* SlotData)
-{
-	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::SerializeData);
-	check(SlotData);
-	DataBytes.Reset();
-	DataClassName = SlotData->GetClass()->GetPathName();
 
-	FMemoryWriter BytesWriter(DataBytes);
-	FObjectAndNameAsStringProxyArchive Ar(BytesWriter, false);
-	SlotData->Serialize(Ar);
+	FMemoryReader TableReader{TableBytes};
+	TableReader.SetUEVer(Ar.UEVer());
+	SerializeTable(TableReader);
+	return !TableReader.IsError();
 }
 
-bool FSEFileHelpers::SaveFileSync(USaveSlot* Slot, FStringView OverrideSlotName, const bool bUseCompression)
+bool FSaveFile::VerifyHeader(FArchive& Ar, int64 HeaderSize)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::SaveFileSync);
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::VerifyHeader);
 
-	if (!ensureMsgf(Slot, TEXT("Slot object must be valid")) ||
-		!ensureMsgf(Slot->GetData(), TEXT("Slot Data object must be valid")))
+	TArray<uint8> HeaderBytes;
+	HeaderBytes.SetNumUninitialized(int32(HeaderSize));
+	Ar.Seek(0);
+	Ar.Serialize(HeaderBytes.GetData(), HeaderSize);
+	if (Ar.IsError() || FXxHash64::HashBuffer(HeaderBytes.GetData(), HeaderSize).Hash != HeaderHash)
 	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Save file is corrupted. Its header doesn't match its checksum"));
 		return false;
 	}
-
-	FString SlotName = OverrideSlotName.IsEmpty() ? Slot->Name.ToString() : FString{OverrideSlotName};
-	FScopedFileWriter FileWriter(GetSlotPath(SlotName));
-	if (FileWriter.IsValid())
-	{
-		FSaveFile File{};
-		File.SerializeInfo(Slot);
-		File.SerializeData(Slot->GetData());
-		File.Write(FileWriter, bUseCompression);
-		return !FileWriter.IsError();
-	}
-	return false;
-}
-
-UE::Tasks::TTask<bool> FSEFileHelpers::SaveFile(
-	USaveSlot* Slot, FString OverrideSlotName, const bool bUseCompression)
-{
-	return BackendPipe.Launch(TEXT("SaveFile"), [Slot, OverrideSlotName, bUseCompression]() {
-		return SaveFileSync(Slot, OverrideSlotName, bUseCompression);
-	});
+	return true;
 }
 
-
-USaveSlot* FSEFileHelpers::LoadFileSync(
-	FStringView SlotName, USaveSlot* SlotHint, bool bLoadData, const USaveManager* Manager)
+void FSaveFile::ReadJournal(const FString& JournalPath)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::LoadFileSync);
-	if (SlotName.IsEmpty() && SlotHint)
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::ReadJournal);
+	FScopedFileReader Reader(JournalPath, FILEREAD_Silent);
+	if (!Reader.IsValid())
 	{
-		SlotName = SlotHint->Name.ToString();
+		return;
 	}
 
-	FScopedFileReader Reader(GetSlotPath(SlotName));
-	if (Reader.IsValid())
+	// Entries are only complete once their table is written. Anything after the last valid table is ignored
+	FArchive& Ar = Reader.GetArchive();
+	TArray<uint8> LastTableBytes;
+	int64 ValidSize = 0;
+	const int64 RecordHeaderSize = sizeof(int32) + sizeof(int64);
+	while (Ar.Tell() + RecordHeaderSize <= Ar.TotalSize())
 	{
-		FSaveFile File{};
-		File.Read(Reader, !bLoadData);
-		USaveSlot* Slot;
+		int32 Tag = 0;
+		int64 Size = 0;
+		Ar << Tag;
+		Ar << Size;
+		const int64 DataOffset = Ar.Tell();
+		if (Ar.IsError() || Size < 0 || DataOffset + Size > Ar.TotalSize())
 		{
-			TRACE_CPUPROFILER_EVENT_SCOPE(DeserializeInfo)
-			Slot = Cast<USaveSlot>(DeserializeObject(SlotHint, File.ClassName, Manager, File.Bytes));
+			break;
 		}
-		if (bLoadData)
+
+		if (Tag == SE_JOURNAL_CHUNK_TAG)
 		{
-			TRACE_CPUPROFILER_EVENT_SCOPE(DeserializeData)
-			Slot->AssignData(Cast<USaveSlotData>(
-				DeserializeObject(Slot->GetData(), File.DataClassName, Slot, File.DataBytes)));
+			Ar.Seek(DataOffset + Size);
+			continue;
 		}
-		return Slot;
+		if (Tag != SE_JOURNAL_TABLE_TAG)
+		{
+			break;
+		}
+
+		TArray<uint8> TableBytes;
+		TableBytes.SetNumUninitialized(int32(Size));
+		Ar.Serialize(TableBytes.GetData(), Size);
+		uint64 Hash = 0;
+		Ar << Hash;
+		if (Ar.IsError() || FXxHash64::HashBuffer(TableBytes.GetData(), Size).Hash != Hash)
+		{
+			break;
+		}
+		LastTableBytes = MoveTemp(TableBytes);
+		ValidSize = Ar.Tell();
+	}
+
+	if (ValidSize < Ar.TotalSize())
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Journal '%s' ends with an incomplete entry. It will be ignored"),
+			*JournalPath);
+	}
+	if (LastTableBytes.IsEmpty())
+	{
+		return;
+	}
+
+	FSaveFile Journaled = *this;
+	uint64 BaseTableHash = 0;
+	FMemoryReader TableReader{LastTableBytes};
+	TableReader.SetUEVer(Ar.UEVer());
+	Journaled.SerializeJournalTable(TableReader, BaseTableHash, JournalPath);
+	if (TableReader.IsError() || BaseTableHash != TableHash)
+	{
+		// Left behind by a save that wrote the whole file again
+		UE_LOG(LogSaveExtension, Warning, TEXT("Journal '%s' doesn't belong to its file. It will be ignored"),
+			*JournalPath);
+		return;
+	}
+	*this = MoveTemp(Journaled);
+	JournalSize = ValidSize;
+}
+
+void FSaveFile::SerializeJournalTable(FArchive& Ar, uint64& BaseTableHash, const FString& JournalPath)
+{
+	Ar << BaseTableHash;
+	Ar << SaveGameFileVersion;
+	Ar << ClassName;
+	Ar << Bytes;
+	Ar << SaveDate;
+	Ar << DataClassName;
+	Ar << CompressionCodec;
+	Ar << CompressionLevel;
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedCompressionDictionaries)
+	{
+		Ar << CompressionDictionaryId;
+	}
+
+	int32 NumChunks = Chunks.Num();
+	Ar << NumChunks;
+	if (Ar.IsLoading())
+	{
+		if (NumChunks < 0)
+		{
+			Ar.SetError();
+			return;
+		}
+		Chunks.SetNum(NumChunks);
+	}
+
+	for (FSaveFileChunk& Chunk : Chunks)
+	{
+		Chunk.Serialize(Ar, SaveGameFileVersion);
+		// Other chunks are still in the file the journal was appended to, or in the blob store
+		bool bInJournal = Chunk.SourceFile == JournalPath;
+		Ar << bInJournal;
+		if (Ar.IsLoading() && bInJournal)
+		{
+			Chunk.SourceFile = JournalPath;
+		}
+	}
+}
+
+bool FSaveFile::ReadChunk(FScopedFileReader& Reader, FSaveFileChunk& Chunk, bool bVerify)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::ReadChunk);
+	if (!Chunk.SourceFile.IsEmpty() && Chunk.SourceFile != Reader.GetFilename())
+	{
+		FScopedFileReader SourceReader(Chunk.SourceFile);
+		return SourceReader.IsValid() && ReadChunk(SourceReader, Chunk, bVerify);
+	}
+
+	FArchive& Ar = Reader.GetArchive();
+	if (Chunk.Offset <= 0 || Chunk.Offset + Chunk.Size > Ar.TotalSize())
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Chunk '%s' is out of the bounds of the file"), *Chunk.Name);
+		return false;
+	}
+
+	Chunk.Bytes.SetNumUninitialized(Chunk.Size);
+	Ar.Seek(Chunk.Offset);
+	Ar.Serialize(Chunk.Bytes.GetData(), Chunk.Size);
+	if (Ar.IsError())
+	{
+		return false;
+	}
+	if (Chunk.bDelta && !RebuildDeltaChunk(Chunk))
+	{
+		Chunk.Bytes.Empty();
+		return false;
+	}
+	if (bVerify && !Chunk.Verify(Chunk.Bytes))
+	{
+		Chunk.Bytes.Empty();
+		return false;
+	}
+	return true;
+}
+
+void FSaveFile::Write(FScopedFileWriter& Writer, FScopedFileReader* BaseReader, const FSaveFile* Base)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::Write);
+
+	SaveGameFileVersion = FSaveGameFileVersion::LatestVersion;
+	DeltaDepth = BaseReader && Base ? Base->DeltaDepth + 1 : 0;
+	if (DeltaDepth == 0)
+	{
+		DeltaBaseName.Reset();
+	}
+	FArchive& Ar = Writer.GetArchive();
+
+	// Written in memory first to compute its checksum
+	TArray<uint8> HeaderBytes;
+	FMemoryWriter HeaderAr{HeaderBytes};
+	{	 // Header information
+		HeaderAr << FileTypeTag;
+		HeaderAr << SaveGameFileVersion;
+		HeaderAr << PackageFileUEVersion;
+		HeaderAr << SavedEngineVersion;
+		HeaderAr << CustomVersionFormat;
+		CustomVersions.Serialize(
+			HeaderAr, static_cast<ECustomVersionSerializationFormat::Type>(CustomVersionFormat));
+	}
+
+	HeaderAr << ClassName;
+	HeaderAr << Bytes;
+	HeaderAr << SaveDate;
+
+	HeaderAr << DataClassName;
+	if (!DataClassName.IsEmpty())
+	{
+		HeaderAr << CompressionCodec;
+		HeaderAr << CompressionLevel;
+		HeaderAr << CompressionDictionaryId;
+	}
+	HeaderHash = FXxHash64::HashBuffer(HeaderBytes.GetData(), HeaderBytes.Num()).Hash;
+	Ar.Serialize(HeaderBytes.GetData(), HeaderBytes.Num());
+
+	if (!DataClassName.IsEmpty())
+	{
+		// Reserve the offset of the table. It is written after the chunks
+		const int64 TocOffsetPosition = Ar.Tell();
+		int64 TocOffset = 0;
+		Ar << TocOffset;
+
+		for (FSaveFileChunk& Chunk : Chunks)
+		{
+			if (Chunk.IsInBlobStore())
+			{
+				continue;
+			}
+			// Thumbnails are read straight from the file (see FSESlotCatalog)
+			if (DeltaDepth > 0 && Chunk.Type != ESaveFileChunkType::Thumbnail)
+			{
+				WriteDeltaChunk(Ar, Chunk, *BaseReader, *Base);
+			}
+			else
+			{
+				WriteChunk(Ar, Chunk);
+			}
+		}
+
+		TocOffset = Ar.Tell();
+		TArray<uint8> TableBytes;
+		FMemoryWriter TableAr{TableBytes};
+		SerializeTable(TableAr);
+		TableHash = FXxHash64::HashBuffer(TableBytes.GetData(), TableBytes.Num()).Hash;
+		Ar.Serialize(TableBytes.GetData(), TableBytes.Num());
+		Ar << TableHash;
+
+		// Written last. A file with no table offset is incomplete
+		Ar.Seek(TocOffsetPosition);
+		Ar << TocOffset;
+	}
+}
+
+/** Hashes the data serialized into it without keeping it */
+class FSEHashWriter : public FArchive
+{
+	FXxHash64Builder Hash;
+	int64 Position = 0;
+	bool bValid = true;
+
+public:
+	FSEHashWriter()
+	{
+		SetIsSaving(true);
+	}
+
+	virtual void Serialize(void* Data, int64 Num) override
+	{
+		Hash.Update(Data, Num);
+		Position += Num;
+	}
+	virtual int64 Tell() override
+	{
+		return Position;
+	}
+	virtual int64 TotalSize() override
+	{
+		return Position;
+	}
+	virtual void Seek(int64 InPos) override
+	{
+		// Bytes already hashed may be overwritten
+		bValid &= InPos == Position;
+		Position = InPos;
+	}
+
+	/** @return hash of all data, or 0 if it is unknown because data was patched after a seek */
+	uint64 GetHash() const
+	{
+		return bValid ? Hash.Finalize().Hash : 0;
+	}
+};
+
+/** Points a chunk to the stored bytes of the same chunk in the file or journal it is appended to */
+static void KeepBaseChunk(FSaveFileChunk& Chunk, const FSaveFileChunk& BaseChunk)
+{
+	Chunk.Offset = BaseChunk.Offset;
+	Chunk.Size = BaseChunk.Size;
+	Chunk.RawSize = BaseChunk.RawSize;
+	Chunk.Version = BaseChunk.Version;
+	Chunk.Hash = BaseChunk.Hash;
+	Chunk.RawHash = BaseChunk.RawHash;
+	Chunk.bAuthenticated = BaseChunk.bAuthenticated;
+	Chunk.bDelta = BaseChunk.bDelta;
+	Chunk.BlobHash = BaseChunk.BlobHash;
+	Chunk.SourceFile = BaseChunk.SourceFile;
+	Chunk.Bytes.Empty();
+}
+
+bool FSaveFile::WriteJournal(FStringView JournalPath, const FSaveFile& Base, ESEFileDurability Durability)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::WriteJournal);
+
+	SaveGameFileVersion = FSaveGameFileVersion::LatestVersion;
+	HeaderHash = Base.HeaderHash;
+	TableHash = Base.TableHash;
+	const FString JournalFile{JournalPath};
+	FScopedFileWriter Writer(JournalFile, FILEWRITE_Append);
+	if (!Writer.IsValid())
+	{
+		return false;
+	}
+	FArchive& Ar = Writer.GetArchive();
+
+	TArray64<uint8> ChunkBytes;
+	for (FSaveFileChunk& Chunk : Chunks)
+	{
+		if (Chunk.IsInBlobStore())
+		{
+			continue;
+		}
+
+		const FSaveFileChunk* BaseChunk = Base.FindChunk(Chunk.Type, Chunk.Name);
+		const bool bStoredAlike = BaseChunk && BaseChunk->bCompressed == Chunk.bCompressed &&
+			BaseChunk->Codec == Chunk.Codec && BaseChunk->bEncrypted == Chunk.bEncrypted &&
+			BaseChunk->bAuthenticated == Chunk.bAuthenticated && BaseChunk->DictionaryId == Chunk.DictionaryId;
+		if (Chunk.Serializer && bStoredAlike && BaseChunk->RawHash != 0)
+		{
+			// Serializing is much cheaper than compressing. Unchanged chunks are never compressed
+			FSEHashWriter HashWriter;
+			{
+				FObjectAndNameAsStringProxyArchive ChunkAr(HashWriter, false);
+				Chunk.Serializer(ChunkAr);
+			}
+			if (HashWriter.GetHash() == BaseChunk->RawHash)
+			{
+				Chunk.Serializer = nullptr;
+				KeepBaseChunk(Chunk, *BaseChunk);
+				continue;
+			}
+		}
+
+		// Changed chunks are written in memory first, since their size precedes them. Only one at a time
+		if (Chunk.Serializer || Chunk.Hash == 0)
+		{
+			ChunkBytes.Reset();
+			FMemoryWriter64 ChunkAr{ChunkBytes};
+			WriteChunk(ChunkAr, Chunk);
+		}
+		else
+		{
+			// Copied chunks already know their checksum
+			ChunkBytes = MoveTemp(Chunk.Bytes);
+			Chunk.Size = ChunkBytes.Num();
+		}
+
+		// Copied chunks, or chunks appended to a file saved without raw checksums
+		if (BaseChunk && BaseChunk->Hash != 0 && BaseChunk->Hash == Chunk.Hash &&
+			(BaseChunk->bDelta || BaseChunk->Size == Chunk.Size))
+		{
+			KeepBaseChunk(Chunk, *BaseChunk);
+			continue;
+		}
+
+		int32 Tag = SE_JOURNAL_CHUNK_TAG;
+		int64 Size = ChunkBytes.Num();
+		Ar << Tag;
+		Ar << Size;
+		Chunk.Offset = Ar.Tell();
+		Ar.Serialize(ChunkBytes.GetData(), ChunkBytes.Num());
+		Chunk.SourceFile = JournalFile;
+	}
+
+	TArray<uint8> TableBytes;
+	FMemoryWriter TableAr{TableBytes};
+	uint64 BaseTableHash = Base.TableHash;
+	SerializeJournalTable(TableAr, BaseTableHash, JournalFile);
+
+	// Written last. An entry without a valid table is incomplete
+	int32 Tag = SE_JOURNAL_TABLE_TAG;
+	int64 Size = TableBytes.Num();
+	uint64 Hash = FXxHash64::HashBuffer(TableBytes.GetData(), TableBytes.Num()).Hash;
+	Ar << Tag;
+	Ar << Size;
+	Ar.Serialize(TableBytes.GetData(), TableBytes.Num());
+	Ar << Hash;
+	JournalSize = Ar.Tell();
+	return Writer.Close(Durability);
+}
+
+bool FSaveFile::StoreBlobs(ESEFileDurability Durability)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::StoreBlobs);
+
+	TArray64<uint8> StoredBytes;
+	for (FSaveFileChunk& Chunk : Chunks)
+	{
+		if (Chunk.Type != ESaveFileChunkType::Level || Chunk.IsInBlobStore())
+		{
+			continue;
+		}
+
+		StoredBytes.Reset();
+		{
+			FMemoryWriter64 StoredAr{StoredBytes};
+			WriteChunk(StoredAr, Chunk);
+		}
+		const FIoHash BlobHash = FIoHash::HashBuffer(StoredBytes.GetData(), StoredBytes.Num());
+		if (!StoreBlob(BlobHash, StoredBytes, Durability))
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Failed to store records of level '%s' as a blob"), *Chunk.Name);
+			return false;
+		}
+		Chunk.BlobHash = BlobHash;
+		Chunk.SourceFile = FSEFileHelpers::GetBlobPath(BlobHash);
+		Chunk.Offset = sizeof(SE_BLOB_TAG);
+	}
+	return true;
+}
+
+void FSaveFile::SerializeTable(FArchive& Ar)
+{
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedChecksums)
+	{
+		Ar << HeaderHash;
+	}
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedDeltaChunks)
+	{
+		Ar << DeltaBaseName;
+		Ar << DeltaDepth;
+	}
+
+	int32 NumChunks = Chunks.Num();
+	Ar << NumChunks;
+	if (Ar.IsLoading())
+	{
+		if (NumChunks < 0)
+		{
+			Ar.SetError();
+			return;
+		}
+		Chunks.SetNum(NumChunks);
+	}
+
+	for (FSaveFileChunk& Chunk : Chunks)
+	{
+		Chunk.Serialize(Ar, SaveGameFileVersion);
+	}
+}
+
+void FSaveFile::SerializeInfo(USaveSlot* Slot)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::SerializeInfo);
+	check(Slot);
+	Bytes.Reset();
+	ClassName = Slot->GetClass()->GetPathName();
+	SaveDate = Slot->Stats.SaveDate;
+
+	FMemoryWriter BytesWriter(Bytes);
+	FObjectAndNameAsStringProxyArchive Ar(BytesWriter, false);
+	Slot->Serialize(Ar);
+}
+
+void FSaveFile::SerializeThumbnail(USaveSlot* Slot)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::SerializeThumbnail);
+	check(Slot);
+
+	TArray<uint8> ThumbnailBytes;
+	if (!Slot->EncodeThumbnail(ThumbnailBytes))
+	{
+		if (Slot->IsThumbnailInFile())
+		{
+			// Never loaded. Keep the one on disk
+			CopyChunk(ESaveFileChunkType::Thumbnail, {}, FSEFileHelpers::GetSlotPath(Slot->Name.ToString()));
+		}
+		return;
+	}
+
+	// Images are already compressed
+	FSaveFileChunk& Chunk = Chunks.AddDefaulted_GetRef();
+	Chunk.Type = ESaveFileChunkType::Thumbnail;
+	Chunk.RawSize = ThumbnailBytes.Num();
+	Chunk.Bytes = TArray64<uint8>(ThumbnailBytes);
+}
+
+void FSaveFile::SerializeData(USaveSlotData* SlotData, bool bCompressData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::SerializeData);
+	check(SlotData);
+	DataBytes.Reset();
+	Chunks.Reset();
+	bIsDataCompressed = bCompressData;
+	DataClassName = SlotData->GetClass()->GetPathName();
+
+	AddChunk(ESaveFileChunkType::Data, {}, [SlotData](FArchive& Ar) {
+		// Tagged properties seek back to patch their sizes. Serialize them in memory first
+		TArray<uint8> PropertyBytes;
+		FMemoryWriter BytesWriter(PropertyBytes);
+		FObjectAndNameAsStringProxyArchive PropertiesAr(BytesWriter, false);
+		SlotData->SerializeProperties(PropertiesAr);
+		Ar.Serialize(PropertyBytes.GetData(), PropertyBytes.Num());
+	}, bCompressData);
+	AddChunk(ESaveFileChunkType::GameInstance, {}, [SlotData](FArchive& Ar) {
+		Ar << SlotData->GameInstance;
+	}, bCompressData);
+	AddLevelChunk(SlotData->RootLevel, bCompressData);
+
+	for (FStreamingLevelRecord& Level : SlotData->SubLevels)
+	{
+		FString LevelName = Level.Name.ToString();
+		if (Level.IsPending())
+		{
+			if (TSharedPtr<FStreamingLevelRecord, ESPMode::ThreadSafe> Spilled =
+					FindSpilledLevel(Level.PendingFile, false))
+			{
+				// Its spill file could not be written. The records are still in memory
+				AddLevelChunk(*Spilled, bCompressData);
+				continue;
+			}
+
+			// Records were never read. Copy them as they are from their file
+			if (!CopyChunk(ESaveFileChunkType::Level, LevelName, Level.PendingFile))
+			{
+				UE_LOG(LogSaveExtension, Warning, TEXT("Records of level '%s' could not be found in '%s'"),
+					*LevelName, *Level.PendingFile);
+			}
+			continue;
+		}
+
+		AddLevelChunk(Level, bCompressData);
+	}
+}
+
+bool FSaveFile::DeserializeData(USaveSlotData* SlotData, FStringView FilePath)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::DeserializeData);
+	check(SlotData);
+	SlotData->CleanRecords(false);
+
+	TArray64<uint8> RawBytes;
+	for (FSaveFileChunk& Chunk : Chunks)
+	{
+		if (Chunk.IsStreamingLevel())
+		{
+			FStreamingLevelRecord& Level = SlotData->SubLevels.AddDefaulted_GetRef();
+			Level.Name = FName{Chunk.Name};
+			Level.PendingFile = FString{FilePath};
+			continue;
+		}
+
+		if (Chunk.Type == ESaveFileChunkType::Level)
+		{
+			FLevelRecord& Level = SlotData->RootLevel;
+			Level.Buffer = LoadRecordBuffer(FilePath, Chunk);
+			if (!Level.Buffer)
+			{
+				// Verified while it was read
+				return false;
+			}
+			const TConstArrayView64<uint8> View = Level.Buffer->GetView();
+			SERecords::FDataViewScope ViewScope{View};
+			FMemoryReaderView Reader{MakeMemoryView(View)};
+			FSEArchive Ar(Reader, true);
+			SerializeLevelChunk(Ar, Level, Chunk.Version);
+			continue;
+		}
+
+		if (!Chunk.IsLoaded() || !Chunk.Decompress(RawBytes))
+		{
+			continue;
+		}
+
+		FMemoryReader64 Reader{RawBytes};
+		FSEArchive Ar(Reader, true);
+		switch (Chunk.Type)
+		{
+			case ESaveFileChunkType::Data:
+				SlotData->SerializeProperties(Ar);
+				break;
+			case ESaveFileChunkType::GameInstance:
+				Ar << SlotData->GameInstance;
+				break;
+			default:
+				break;
+		}
+	}
+	return true;
+}
+
+TSharedPtr<FSERecordBuffer, ESPMode::ThreadSafe> FSaveFile::LoadRecordBuffer(
+	FStringView FilePath, FSaveFileChunk& Chunk)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::LoadRecordBuffer);
+	auto Buffer = MakeShared<FSERecordBuffer, ESPMode::ThreadSafe>();
+	if (!Chunk.SourceFile.IsEmpty())
+	{
+		FilePath = Chunk.SourceFile;
+	}
+
+	if (!Chunk.bCompressed && !Chunk.bDelta && Chunk.Bytes.IsEmpty() && Chunk.Size > 0)
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		Buffer->MappedFile.Reset(PlatformFile.OpenMapped(FilePath.GetData()));
+		if (Buffer->MappedFile && Chunk.Offset + Chunk.Size <= Buffer->MappedFile->GetFileSize())
+		{
+			Buffer->MappedRegion.Reset(Buffer->MappedFile->MapRegion(Chunk.Offset, Chunk.Size));
+			if (Buffer->MappedRegion)
+			{
+				return Chunk.Verify(Buffer->GetView()) ? Buffer : nullptr;
+			}
+		}
+		// Mapping not supported. Read it instead
+		Buffer->MappedFile.Reset();
+	}
+
+	if (Chunk.bCompressed && !Chunk.bDelta && !Chunk.IsLoaded())
+	{
+		// Decompressed straight from the file. Its stored bytes are never held in memory
+		FScopedFileReader Reader(FilePath);
+		if (!Reader.IsValid())
+		{
+			return {};
+		}
+		FArchive& Ar = Reader.GetArchive();
+		if (Chunk.Offset <= 0 || Chunk.Offset + Chunk.Size > Ar.TotalSize())
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Chunk '%s' is out of the bounds of the file"), *Chunk.Name);
+			return {};
+		}
+		Ar.Seek(Chunk.Offset);
+		uint64 StoredHash = 0;
+		if (!Chunk.Decompress(Ar, Buffer->Bytes, &StoredHash))
+		{
+			return {};
+		}
+		if (Chunk.Hash != 0 && StoredHash != Chunk.Hash)
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Chunk '%s' is corrupted. It doesn't match its checksum"),
+				*Chunk.Name);
+			return {};
+		}
+		return Buffer;
+	}
+
+	if (!Chunk.IsLoaded())
+	{
+		FScopedFileReader Reader(FilePath);
+		if (!Reader.IsValid() || !ReadChunk(Reader, Chunk))
+		{
+			return {};
+		}
+	}
+
+	if (!Chunk.bCompressed)
+	{
+		Buffer->Bytes = MoveTemp(Chunk.Bytes);
+	}
+	else if (!Chunk.Decompress(Buffer->Bytes))
+	{
+		return {};
+	}
+	Chunk.Bytes.Empty();
+	return Buffer;
+}
+
+FSaveFileChunk* FSaveFile::FindChunk(ESaveFileChunkType Type, FStringView Name)
+{
+	return Chunks.FindByPredicate([Type, Name](const FSaveFileChunk& Chunk) {
+		return Chunk.Type == Type && Name.Equals(Chunk.Name, ESearchCase::CaseSensitive);
+	});
+}
+
+const FSaveFileChunk* FSaveFile::FindChunk(ESaveFileChunkType Type, FStringView Name) const
+{
+	return const_cast<FSaveFile*>(this)->FindChunk(Type, Name);
+}
+
+void FSaveFile::AddChunk(ESaveFileChunkType Type, FString Name, TFunction<void(FArchive&)> Serializer,
+	bool bCompressData)
+{
+	FSaveFileChunk& Chunk = Chunks.AddDefaulted_GetRef();
+	Chunk.Type = Type;
+	Chunk.Name = MoveTemp(Name);
+	// Blocks are encrypted after being compressed
+	Chunk.bEncrypted = EncryptionKey.IsValid();
+	Chunk.bCompressed = bCompressData || Chunk.bEncrypted;
+	Chunk.Codec = CompressionCodec;
+	Chunk.Version = FSaveGameFileVersion::LatestVersion;
+	Chunk.Serializer = MoveTemp(Serializer);
+}
+
+void FSaveFile::AddLevelChunk(FLevelRecord& Level, bool bCompressData)
+{
+	Level.bGroupByClass = bGroupRecordsByClass;
+	Level.TransformPositionBits = TransformPositionBits;
+	Level.TransformRotationBits = TransformRotationBits;
+	if (Level.Tables == ESELevelTables::None)
+	{
+		AddChunk(ESaveFileChunkType::Level, Level.Name.ToString(), [&Level](FArchive& Ar) {
+			Level.Serialize(Ar);
+		}, bCompressData);
+	}
+	else
+	{
+		AddChunk(ESaveFileChunkType::Level, Level.Name.ToString(), [&Level](FArchive& Ar) {
+			Level.SerializeWithTables(Ar);
+		}, bCompressData);
+	}
+
+	// Records loaded from an older file and never serialized again keep the format of their data
+	if (Level.Tables != ESELevelTables::Latest)
+	{
+		Chunks.Last().Version = GetLevelTablesVersion(Level.Tables);
+	}
+
+	// Small chunks compress poorly on their own. Their blocks get the dictionary as history
+	FSaveFileChunk& Chunk = Chunks.Last();
+	if (bCompressData && CompressionDictionaryId != 0 && Chunk.IsStreamingLevel())
+	{
+		Chunk.DictionaryId = CompressionDictionaryId;
+		Chunk.Codec = ESECompressionCodec::Zlib;
+	}
+}
+
+void FSaveFile::WriteChunk(FArchive& Ar, FSaveFileChunk& Chunk)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::WriteChunk);
+
+	Chunk.Offset = Ar.Tell();
+	if (Chunk.Serializer)
+	{
+		auto Dictionary = USECompressionDictionary::Find(Chunk.DictionaryId);
+		if (Chunk.DictionaryId != 0 && !Dictionary)
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Compression dictionary %08x of chunk '%s' is not loaded"),
+				Chunk.DictionaryId, *Chunk.Name);
+			Chunk.DictionaryId = 0;
+		}
+
+		// Compressed straight into the file. Only one block is kept in memory
+		FSEBlockWriter BlockWriter(Ar, Chunk.bCompressed, Chunk.Codec, CompressionLevel, Dictionary,
+			Chunk.bEncrypted ? EncryptionKey : nullptr);
+		{
+			FObjectAndNameAsStringProxyArchive ChunkAr(BlockWriter, false);
+			Chunk.Serializer(ChunkAr);
+		}
+		if (!BlockWriter.Close())
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Failed to write chunk '%s'"), *Chunk.Name);
+			Ar.SetError();
+		}
+		Chunk.RawSize = BlockWriter.TotalSize();
+		Chunk.Hash = BlockWriter.GetStoredHash();
+		Chunk.RawHash = BlockWriter.GetRawHash();
+		Chunk.Serializer = nullptr;
+	}
+	else
+	{
+		// Chunks left in another file are read right before they are written, one at a time
+		if (!Chunk.IsLoaded() && !Chunk.SourceFile.IsEmpty())
+		{
+			FScopedFileReader SourceReader(Chunk.SourceFile);
+			if (!SourceReader.IsValid() || !ReadChunk(SourceReader, Chunk))
+			{
+				UE_LOG(LogSaveExtension, Warning, TEXT("Failed to read chunk '%s' from '%s'"), *Chunk.Name,
+					*Chunk.SourceFile);
+				Ar.SetError();
+			}
+		}
+		Ar.Serialize(Chunk.Bytes.GetData(), Chunk.Bytes.Num());
+		// Copied chunks may come from files without checksums
+		Chunk.Hash = FXxHash64::HashBuffer(Chunk.Bytes.GetData(), Chunk.Bytes.Num()).Hash;
+		Chunk.Bytes.Empty();
+	}
+	Chunk.Size = Ar.Tell() - Chunk.Offset;
+	Chunk.SourceFile.Reset();
+	Chunk.BlobHash = {};
+}
+
+void FSaveFile::WriteDeltaChunk(
+	FArchive& Ar, FSaveFileChunk& Chunk, FScopedFileReader& BaseReader, const FSaveFile& Base)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::WriteDeltaChunk);
+
+	// Compared with the base block by block. Both are kept in memory while they are
+	TArray64<uint8> StoredBytes;
+	{
+		FMemoryWriter64 StoredAr{StoredBytes};
+		WriteChunk(StoredAr, Chunk);
+	}
+
+	TArray64<uint8> DeltaBytes;
+	const FSaveFileChunk* BaseChunk = Base.FindChunk(Chunk.Type, Chunk.Name);
+	if (BaseChunk && BaseChunk->bCompressed == Chunk.bCompressed)
+	{
+		FSaveFileChunk StoredBase = *BaseChunk;
+		if (ReadChunk(BaseReader, StoredBase))
+		{
+			EncodeDelta(StoredBytes, StoredBase.Bytes, Chunk.bCompressed, DeltaBytes);
+		}
+	}
+
+	// Rebuilding a chunk reads its base. Only worth it if most blocks didn't change
+	Chunk.Offset = Ar.Tell();
+	Chunk.bDelta = !DeltaBytes.IsEmpty() && DeltaBytes.Num() < StoredBytes.Num() / 2;
+	if (Chunk.bDelta)
+	{
+		Ar.Serialize(DeltaBytes.GetData(), DeltaBytes.Num());
+	}
+	else
+	{
+		Ar.Serialize(StoredBytes.GetData(), StoredBytes.Num());
+	}
+	Chunk.Size = Ar.Tell() - Chunk.Offset;
+}
+
+bool FSaveFile::CopyChunk(ESaveFileChunkType Type, const FString& Name, FStringView SourceFilePath)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFile::CopyChunk);
+
+	FScopedFileReader Reader(SourceFilePath);
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	FSaveFile Source{};
+	Source.Read(Reader, true);
+	FSaveFileChunk* Chunk = Source.FindChunk(Type, Name);
+	if (Chunk && Chunk->IsInBlobStore())
+	{
+		// Blobs are shared. Keep referencing it
+		Chunks.Add(MoveTemp(*Chunk));
+		return true;
+	}
+	if (!Chunk || !Source.ReadChunk(Reader, *Chunk))
+	{
+		return false;
+	}
+	Chunks.Add(MoveTemp(*Chunk));
+	return true;
+}
+
+bool FSaveFileChunk::IsStreamingLevel() const
+{
+	return Type == ESaveFileChunkType::Level && Name != FPersistentLevelRecord::PersistentName.ToString();
+}
+
+bool FSaveFileChunk::Verify(TConstArrayView64<uint8> StoredBytes) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFileChunk::Verify);
+	if (Hash == 0)
+	{
+		return true;
+	}
+	if (FXxHash64::HashBuffer(StoredBytes.GetData(), StoredBytes.Num()).Hash != Hash)
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Chunk '%s' is corrupted. It doesn't match its checksum"), *Name);
+		return false;
+	}
+	return true;
+}
+
+bool FSaveFileChunk::Decompress(TArray64<uint8>& OutBytes) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSaveFileChunk::Decompress);
+	if (!bCompressed)
+	{
+		OutBytes = Bytes;
+		return true;
+	}
+
+	FMemoryReader64 BytesReader{Bytes};
+	return Decompress(BytesReader, OutBytes);
+}
+
+bool FSaveFileChunk::Decompress(FArchive& StoredAr, TArray64<uint8>& OutBytes, uint64* OutStoredHash) const
+{
+	auto Dictionary = USECompressionDictionary::Find(DictionaryId);
+	if (DictionaryId != 0 && !Dictionary)
+	{
+		UE_LOG(LogSaveExtension, Warning,
+			TEXT("Chunk '%s' was compressed with dictionary %08x, which is not loaded"), *Name, DictionaryId);
+		return false;
+	}
+
+	TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> EncryptionKey;
+	if (bEncrypted)
+	{
+		EncryptionKey = FSEFileHelpers::GetEncryptionKey();
+		if (!EncryptionKey)
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Chunk '%s' is encrypted, but no encryption key is provided"),
+				*Name);
+			return false;
+		}
+	}
+
+	OutBytes.SetNumUninitialized(RawSize);
+	FSEBlockReader BlockReader(
+		StoredAr, true, Codec, RawSize, MoveTemp(Dictionary), MoveTemp(EncryptionKey), bAuthenticated);
+	BlockReader.Serialize(OutBytes.GetData(), OutBytes.Num());
+	if (BlockReader.IsError())
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Failed to decompress chunk '%s'"), *Name);
+		OutBytes.Reset();
+		return false;
+	}
+	if (OutStoredHash)
+	{
+		*OutStoredHash = BlockReader.GetStoredHash();
+	}
+	return true;
+}
+
+void FSaveFileChunk::Serialize(FArchive& Ar, int32 SaveGameFileVersion)
+{
+	Ar << Type;
+	Ar << Name;
+	Ar << bCompressed;
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedCompressionCodecs)
+	{
+		Ar << Codec;
+	}
+	else
+	{
+		Codec = ESECompressionCodec::Zlib;
+	}
+	Ar << Offset;
+	Ar << Size;
+	Ar << RawSize;
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedLevelTables)
+	{
+		Ar << Version;
+	}
+	else
+	{
+		Version = SaveGameFileVersion;
+	}
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedChecksums)
+	{
+		Ar << Hash;
+	}
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedDeltaChunks)
+	{
+		Ar << bDelta;
+	}
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedBlobStore)
+	{
+		Ar << BlobHash;
+	}
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedCompressionDictionaries)
+	{
+		Ar << DictionaryId;
+	}
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedEncryptedChunks)
+	{
+		Ar << bEncrypted;
+	}
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedRawChunkHashes)
+	{
+		Ar << RawHash;
+	}
+	if (SaveGameFileVersion >= FSaveGameFileVersion::AddedAuthenticatedEncryption)
+	{
+		Ar << bAuthenticated;
+	}
+	else if (Ar.IsLoading())
+	{
+		// Only encrypted blocks changed
+		bAuthenticated = !bEncrypted;
+	}
+	if (Ar.IsLoading())
+	{
+		SourceFile = BlobHash.IsZero() ? FString{} : FSEFileHelpers::GetBlobPath(BlobHash);
+	}
+}
+
+/** Renames a completely written temporary file over the file of a slot */
+static bool ReplaceFile(const FString& FilePath, const FString& TempFilePath)
+{
+	// Rename is atomic where the platform allows replacing files. Otherwise the previous file is deleted
+	// first, and the temporary file will be recovered if we crash before moving it.
+	TRACE_CPUPROFILER_EVENT_SCOPE(ReplaceFile);
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.MoveFile(*FilePath, *TempFilePath) &&
+		!IFileManager::Get().Move(*FilePath, *TempFilePath, true, true, false, true))
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Failed to replace '%s' with '%s'"), *FilePath, *TempFilePath);
+		return false;
+	}
+	return true;
+}
+
+bool FSEFileHelpers::SaveFileSync(USaveSlot* Slot, FStringView OverrideSlotName, const bool bUseCompression)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::SaveFileSync);
+
+	if (!ensureMsgf(Slot, TEXT("Slot object must be valid")) ||
+		!ensureMsgf(Slot->GetData(), TEXT("Slot Data object must be valid")))
+	{
+		return false;
+	}
+
+	FString SlotName = OverrideSlotName.IsEmpty() ? Slot->Name.ToString() : FString{OverrideSlotName};
+	const FString FilePath = GetSlotPath(SlotName);
+	const FString TempFilePath = GetTempSlotPath(SlotName);
+
+	FSaveFile File{};
+	ApplySlotSettings(File, Slot);
+	if (Slot->bEncryptFiles && !File.EncryptionKey)
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Slot '%s' must be encrypted, but no encryption key is provided"),
+			*SlotName);
+		return false;
+	}
+	File.SerializeInfo(Slot);
+	File.SerializeData(Slot->GetData(), bUseCompression);
+	File.SerializeThumbnail(Slot);
+	if (Slot->bUseBlobStore && !File.StoreBlobs(Slot->FileDurability))
+	{
+		return false;
+	}
+
+	const FString JournalPath = GetJournalSlotPath(SlotName);
+	if (Slot->bUseJournal)
+	{
+		FSaveFile Base{};
+		{
+			FScopedFileReader BaseReader(FilePath, FILEREAD_Silent);
+			if (BaseReader.IsValid())
+			{
+				Base.Read(BaseReader, true);
+			}
+		}
+
+		// The whole file is written again if the journal ends with an incomplete entry
+		const int64 JournalFileSize = FMath::Max<int64>(IFileManager::Get().FileSize(*JournalPath), 0);
+		if (Base.TableHash != 0 && !Base.bCorrupted && JournalFileSize == Base.JournalSize)
+		{
+			if (!File.WriteJournal(JournalPath, Base, Slot->FileDurability))
+			{
+				UE_LOG(LogSaveExtension, Warning, TEXT("Failed to append to journal '%s'"), *JournalPath);
+				return false;
+			}
+			FSESlotCatalog::Get().Update(SlotName, File);
+
+			// Big journals are merged into the file after this save, instead of delaying it
+			const int64 MaxJournalSize = int64(FMath::Max(Slot->MaxJournalSize, 1)) * 1024 * 1024;
+			if (File.JournalSize >= MaxJournalSize)
+			{
+				CompactJournal(SlotName, Slot->FileDurability);
+			}
+			return true;
+		}
+	}
+
+	// Delta saves are written against the current file, which is then kept as their base
+	FSaveFile Base{};
+	TUniquePtr<FScopedFileReader> BaseReader;
+	if (Slot->bUseDeltaSaves && !Slot->bUseJournal)
+	{
+		BaseReader = MakeUnique<FScopedFileReader>(FilePath, FILEREAD_Silent);
+		if (BaseReader->IsValid())
+		{
+			Base.Read(*BaseReader, true);
+		}
+		// Bases can't have a journal. It would not be found once they are renamed
+		if (Base.TableHash != 0 && !Base.bCorrupted && Base.JournalSize == 0 &&
+			Base.DeltaDepth < Slot->MaxDeltaChain)
+		{
+			File.DeltaBaseName = FPaths::GetCleanFilename(GetDeltaBasePath(SlotName, Base.DeltaDepth + 1));
+		}
+		else
+		{
+			BaseReader.Reset();
+		}
+	}
+
+	{
+		FScopedFileWriter FileWriter(TempFilePath);
+		if (!FileWriter.IsValid())
+		{
+			return false;
+		}
+		File.Write(FileWriter, BaseReader.Get(), &Base);
+		if (!FileWriter.Close(Slot->FileDurability))
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Failed to write file '%s'"), *TempFilePath);
+			IFileManager::Get().Delete(*TempFilePath, false, true, true);
+			return false;
+		}
+	}
+	BaseReader.Reset();
+
+	// The new file needs its base to be read. If we crash before the new file is moved, it will be recovered
+	const FString DeltaBasePath = File.DeltaBaseName.IsEmpty() ? FString{} : GetSaveFolder() / File.DeltaBaseName;
+	if (!DeltaBasePath.IsEmpty() && !IFileManager::Get().Move(*DeltaBasePath, *FilePath, true, true, false, true))
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Failed to keep '%s' as '%s'"), *FilePath, *DeltaBasePath);
+		IFileManager::Get().Delete(*TempFilePath, false, true, true);
+		return false;
+	}
+
+	if (Slot->bVerifyAfterSave && !VerifyFileSync(TempFilePath))
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("File '%s' was corrupted while writing it"), *TempFilePath);
+		IFileManager::Get().Delete(*TempFilePath, false, true, true);
+		if (!DeltaBasePath.IsEmpty())
+		{
+			IFileManager::Get().Move(*FilePath, *DeltaBasePath, true, true, false, true);
+		}
+		return false;
+	}
+
+	if (!ReplaceFile(FilePath, TempFilePath))
+	{
+		return false;
+	}
+	// The new file contains everything in the journal
+	IFileManager::Get().Delete(*JournalPath, false, false, true);
+	if (File.DeltaDepth == 0)
+	{
+		DeleteDeltaBases(SlotName);
+	}
+
+	FSESlotCatalog::Get().Update(SlotName, File);
+	return true;
+}
+
+UE::Tasks::TTask<bool> FSEFileHelpers::SaveFile(
+	USaveSlot* Slot, FString OverrideSlotName, const bool bUseCompression)
+{
+	return BackendPipe.Launch(TEXT("SaveFile"), [Slot, OverrideSlotName, bUseCompression]() {
+		return SaveFileSync(Slot, OverrideSlotName, bUseCompression);
+	});
+}
+
+
+bool FSEFileHelpers::CompactJournalSync(FStringView SlotName, ESEFileDurability Durability)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::CompactJournalSync);
+	const FString FilePath = GetSlotPath(SlotName);
+	const FString TempFilePath = GetTempSlotPath(SlotName);
+
+	FSaveFile File{};
+	{
+		FScopedFileReader Reader(FilePath, FILEREAD_Silent);
+		if (!Reader.IsValid())
+		{
+			return false;
+		}
+		File.Read(Reader, true);
+	}
+	if (File.JournalSize == 0 || File.bCorrupted || !File.IsChunked())
+	{
+		// Already written again by a full save
+		return false;
+	}
+
+	// Stored chunks are copied as they are. They are read from the file or the journal when written
+	for (FSaveFileChunk& Chunk : File.Chunks)
+	{
+		if (Chunk.SourceFile.IsEmpty())
+		{
+			Chunk.SourceFile = FilePath;
+		}
+	}
+	{
+		FScopedFileWriter FileWriter(TempFilePath);
+		if (!FileWriter.IsValid())
+		{
+			return false;
+		}
+		File.Write(FileWriter);
+		if (!FileWriter.Close(Durability))
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Failed to compact the journal of '%s'"), *FilePath);
+			IFileManager::Get().Delete(*TempFilePath, false, true, true);
+			return false;
+		}
+	}
+
+	if (!ReplaceFile(FilePath, TempFilePath))
+	{
+		return false;
+	}
+	IFileManager::Get().Delete(*GetJournalSlotPath(SlotName), false, false, true);
+	DeleteDeltaBases(SlotName);
+	FSESlotCatalog::Get().Update(SlotName, File);
+	return true;
+}
+
+UE::Tasks::TTask<bool> FSEFileHelpers::CompactJournal(FString SlotName, ESEFileDurability Durability)
+{
+	return BackendPipe.Launch(TEXT("CompactJournal"), [SlotName, Durability]() {
+		return CompactJournalSync(SlotName, Durability);
+	}, UE::Tasks::ETaskPriority::BackgroundLow);
+}
+
+
+USaveSlot* FSEFileHelpers::LoadFileSync(
+	FStringView SlotName, USaveSlot* SlotHint, bool bLoadData, const USaveManager* Manager)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::LoadFileSync);
+	if (SlotName.IsEmpty() && SlotHint)
+	{
+		SlotName = SlotHint->Name.ToString();
+	}
+
+	const FString FilePath = GetSlotPath(SlotName);
+	FScopedFileReader Reader(FilePath);
+	if (Reader.IsValid())
+	{
+		FSaveFile File{};
+		File.Read(Reader, !bLoadData);
+		if (File.bCorrupted)
+		{
+			// Fail before anything is deserialized
+			UE_LOG(LogSaveExtension, Error, TEXT("Slot '%s' is corrupted and can't be loaded"), SlotName.GetData());
+			return nullptr;
+		}
+
+		USaveSlot* Slot;
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(DeserializeInfo)
+			Slot = Cast<USaveSlot>(DeserializeObject(SlotHint, File.ClassName, Manager, File.Bytes));
+		}
+		if (Slot)
+		{
+			Slot->MarkThumbnailInFile(File.FindChunk(ESaveFileChunkType::Thumbnail) != nullptr);
+		}
+		if (Slot && bLoadData)
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(DeserializeData)
+			if (File.IsChunked())
+			{
+				auto* SlotData =
+					Cast<USaveSlotData>(FindOrCreateObject(Slot->GetData(), File.DataClassName, Slot));
+				if (SlotData && !File.DeserializeData(SlotData, FilePath))
+				{
+					UE_LOG(LogSaveExtension, Error, TEXT("Slot '%s' is corrupted and can't be loaded"),
+						SlotName.GetData());
+					return nullptr;
+				}
+				Slot->AssignData(SlotData);
+			}
+			else
+			{
+				Slot->AssignData(Cast<USaveSlotData>(
+					DeserializeObject(Slot->GetData(), File.DataClassName, Slot, File.DataBytes)));
+			}
+		}
+		return Slot;
 	}
 	return nullptr;
 }
@@ -312,6 +1941,8 @@ UE::Tasks::TTask<USaveSlot*> FSEFileHelpers::LoadFile(
 	FString SlotName, USaveSlot* SlotHint, bool bLoadData, const USaveManager* Manager)
 {
 	return BackendPipe.Launch(TEXT("LoadFile"), [SlotName, SlotHint, bLoadData, Manager]() {
+		// In the pipe, so that no save is replacing the file at the same time
+		RecoverFileSync(SlotName.IsEmpty() && SlotHint ? SlotHint->Name.ToString() : SlotName);
 		USaveSlot* Slot = LoadFileSync(SlotName, SlotHint, bLoadData, Manager);
 		// In case we create the slot from async loading thread
 		if (Slot)
@@ -326,13 +1957,219 @@ UE::Tasks::TTask<USaveSlot*> FSEFileHelpers::LoadFile(
 	});
 }
 
-bool FSEFileHelpers::DeleteFile(FStringView SlotName)
+bool FSEFileHelpers::LoadThumbnailSync(FStringView SlotName, TArray<uint8>& OutBytes)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::LoadThumbnailSync);
+	FScopedFileReader Reader(GetSlotPath(SlotName));
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	FSaveFileChunk Chunk;
+	Chunk.Type = ESaveFileChunkType::Thumbnail;
+	// The catalog knows where the thumbnail is. Otherwise find it in the table of contents
+	if (!FSESlotCatalog::Get().FindThumbnail(SlotName, Chunk.Offset, Chunk.Size))
+	{
+		FSaveFile File{};
+		File.Read(Reader, true);
+		const FSaveFileChunk* FileChunk = File.FindChunk(ESaveFileChunkType::Thumbnail);
+		if (!FileChunk)
+		{
+			return false;
+		}
+		Chunk.Offset = FileChunk->Offset;
+		Chunk.Size = FileChunk->Size;
+		Chunk.SourceFile = FileChunk->SourceFile;
+	}
+
+	if (!FSaveFile::ReadChunk(Reader, Chunk))
+	{
+		return false;
+	}
+	OutBytes = TArray<uint8>(Chunk.Bytes);
+	return true;
+}
+
+bool FSEFileHelpers::LoadLevelsSync(USaveSlotData* SlotData, TArrayView<const FName> LevelNames)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::LoadLevelsSync);
+	check(SlotData);
+
+	bool bSuccess = true;
+	// Levels are grouped by file so that each file is only opened once
+	TMap<FString, TArray<FLevelRecord*>> LevelsByFile;
+	for (const FName LevelName : LevelNames)
+	{
+		FLevelRecord* Level = SlotData->FindLevelRecord(LevelName);
+		if (Level && Level->IsPending())
+		{
+			LevelsByFile.FindOrAdd(Level->PendingFile).Add(Level);
+		}
+	}
+
+	for (auto& FileLevels : LevelsByFile)
+	{
+		const bool bSpilled = FileLevels.Key.StartsWith(GetSpillFolder());
+		if (bSpilled)
+		{
+			if (TSharedPtr<FStreamingLevelRecord, ESPMode::ThreadSafe> Spilled =
+					FindSpilledLevel(FileLevels.Key, true))
+			{
+				// Its spill file could not be written
+				*FileLevels.Value[0] = MoveTemp(*Spilled);
+				continue;
+			}
+		}
+
+		bool bFileLoaded = true;
+		{
+			FScopedFileReader Reader(FileLevels.Key);
+			FSaveFile File{};
+			if (Reader.IsValid())
+			{
+				File.Read(Reader, true);
+			}
+
+			for (FLevelRecord* Level : FileLevels.Value)
+			{
+				const FName LevelName = Level->Name;
+				Level->CleanRecords();
+
+				FSaveFileChunk* Chunk = File.FindChunk(ESaveFileChunkType::Level, LevelName.ToString());
+				TSharedPtr<FSERecordBuffer, ESPMode::ThreadSafe> Buffer =
+					Chunk ? FSaveFile::LoadRecordBuffer(FileLevels.Key, *Chunk) : nullptr;
+				if (!Buffer)
+				{
+					UE_LOG(LogSaveExtension, Warning, TEXT("Failed to read records of level '%s' from '%s'"),
+						*LevelName.ToString(), *FileLevels.Key);
+					bFileLoaded = false;
+					continue;
+				}
+
+				// Records point into the buffer instead of copying their data
+				const TConstArrayView64<uint8> View = Buffer->GetView();
+				SERecords::FDataViewScope ViewScope{View};
+				FMemoryReaderView ChunkReader{MakeMemoryView(View)};
+				FSEArchive Ar(ChunkReader, true);
+				SerializeLevelChunk(Ar, *Level, Chunk->Version);
+				Level->Name = LevelName;
+				Level->Buffer = MoveTemp(Buffer);
+			}
+		}
+
+		bSuccess &= bFileLoaded;
+		if (bSpilled && bFileLoaded)
+		{
+			// Spill files are always compressed, so records never point into them
+			IFileManager::Get().Delete(*FileLevels.Key, false, false, true);
+		}
+	}
+	return bSuccess;
+}
+
+UE::Tasks::TTask<bool> FSEFileHelpers::SpillLevels(USaveSlot* Slot, TArrayView<const FName> LevelNames)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::SpillLevels);
+	check(IsInGameThread());
+	USaveSlotData* SlotData = Slot ? Slot->GetData() : nullptr;
+	if (!SlotData)
+	{
+		return BackendPipe.Launch(TEXT("SpillLevels"), []() {
+			return false;
+		});
+	}
+
+	FSaveFile Settings{};
+	ApplySlotSettings(Settings, Slot);
+	if (Slot->bEncryptFiles && !Settings.EncryptionKey)
+	{
+		// Records are never written unencrypted
+		return BackendPipe.Launch(TEXT("SpillLevels"), []() {
+			return false;
+		});
+	}
+	Settings.ClassName = Slot->GetClass()->GetPathName();
+	Settings.DataClassName = SlotData->GetClass()->GetPathName();
+
+	// Records are moved out of the slot data so that it can keep changing while they are written
+	TArray<TPair<FString, TSharedPtr<FStreamingLevelRecord, ESPMode::ThreadSafe>>> Levels;
+	for (const FName LevelName : LevelNames)
+	{
+		FStreamingLevelRecord* Level = SlotData->SubLevels.FindByPredicate([LevelName](const auto& Record) {
+			return Record.Name == LevelName;
+		});
+		if (!Level || Level->IsPending())
+		{
+			continue;
+		}
+
+		const FString SpillPath = GetSpillFolder() / FGuid::NewGuid().ToString() + TEXT(".spill");
+		auto Spilled = MakeShared<FStreamingLevelRecord, ESPMode::ThreadSafe>(MoveTemp(*Level));
+		Level->CleanRecords();
+		Level->Name = LevelName;
+		Level->PendingFile = SpillPath;
+		{
+			FScopeLock ScopeLock(&SpilledLevelsLock);
+			SpilledLevels.Add(SpillPath, Spilled);
+		}
+		Levels.Emplace(SpillPath, MoveTemp(Spilled));
+	}
+
+	return BackendPipe.Launch(TEXT("SpillLevels"), [Settings = MoveTemp(Settings), Levels = MoveTemp(Levels)]() {
+		bool bSuccess = true;
+		for (const auto& Level : Levels)
+		{
+			// Same format as a slot with a single level, so that saving copies its chunk as it is
+			FSaveFile File = Settings;
+			File.SerializeLevel(*Level.Value, true);
+			FScopedFileWriter Writer(Level.Key);
+			if (Writer.IsValid())
+			{
+				File.Write(Writer);
+			}
+			if (!Writer.IsValid() || !Writer.Close(ESEFileDurability::None))
+			{
+				UE_LOG(LogSaveExtension, Warning, TEXT("Failed to spill records of level '%s'. They stay in memory"),
+					*Level.Value->Name.ToString());
+				bSuccess = false;
+				continue;
+			}
+			FindSpilledLevel(Level.Key, true);
+		}
+		return bSuccess;
+	});
+}
+
+UE::Tasks::TTask<bool> FSEFileHelpers::LoadLevels(USaveSlotData* SlotData, TArray<FName> LevelNames)
 {
-	return IFileManager::Get().Delete(*GetSlotPath(SlotName), true, false, true);
+	return BackendPipe.Launch(TEXT("LoadLevels"), [SlotData, LevelNames = MoveTemp(LevelNames)]() {
+		return LoadLevelsSync(SlotData, LevelNames);
+	});
+}
+
+bool FSEFileHelpers::DeleteFile(FStringView SlotName, bool bCollectBlobs)
+{
+	IFileManager::Get().Delete(*GetTempSlotPath(SlotName), false, false, true);
+	IFileManager::Get().Delete(*GetJournalSlotPath(SlotName), false, false, true);
+	DeleteDeltaBases(SlotName);
+	const bool bDeleted = IFileManager::Get().Delete(*GetSlotPath(SlotName), true, false, true);
+	FSESlotCatalog::Get().Remove(SlotName);
+	if (bCollectBlobs)
+	{
+		CollectBlobs();
+	}
+	return bDeleted;
 }
 
 bool FSEFileHelpers::FileExists(FStringView SlotName)
 {
+	// Avoid touching the disk if the catalog knows about the slot
+	const TOptional<bool> bCataloged = FSESlotCatalog::Get().Contains(SlotName);
+	if (bCataloged.IsSet())
+	{
+		return bCataloged.GetValue();
+	}
 	return IFileManager::Get().FileSize(*GetSlotPath(SlotName)) >= 0;
 }
 
@@ -347,18 +2184,241 @@ FString FSEFileHelpers::GetSlotPath(FStringView SlotName)
 	return GetSaveFolder() / FString::Printf(TEXT("%s.sav"), SlotName.GetData());
 }
 
+FString FSEFileHelpers::GetTempSlotPath(FStringView SlotName)
+{
+	return GetSaveFolder() / FString::Printf(TEXT("%s.sav.tmp"), SlotName.GetData());
+}
+
+FString FSEFileHelpers::GetJournalSlotPath(FStringView SlotName)
+{
+	return GetJournalPath(GetSlotPath(SlotName));
+}
+
+const FString& FSEFileHelpers::GetSpillFolder()
+{
+	// Servers may run many instances on the same machine
+	static const FString Folder = FString::Printf(
+		TEXT("%sSaveSpill/%u/"), *FPaths::ProjectSavedDir(), FPlatformProcess::GetCurrentProcessId());
+	return Folder;
+}
+
+FSEGetEncryptionKey& FSEFileHelpers::GetEncryptionKeyDelegate()
+{
+	static FSEGetEncryptionKey Delegate;
+	return Delegate;
+}
+
+TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> FSEFileHelpers::GetEncryptionKey()
+{
+	FAES::FAESKey Key;
+	const FSEGetEncryptionKey& Delegate = GetEncryptionKeyDelegate();
+	if (!Delegate.IsBound() || !Delegate.Execute(Key) || !Key.IsValid())
+	{
+		return {};
+	}
+	return MakeShared<const FAES::FAESKey, ESPMode::ThreadSafe>(Key);
+}
+
+FString FSEFileHelpers::GetBlobPath(const FIoHash& Hash)
+{
+	return GetSaveFolder() / FString::Printf(TEXT("Blobs/%s.blob"), *LexToString(Hash));
+}
+
 void FSEFileHelpers::FindAllFilesSync(TArray<FString>& FoundSlots)
 {
 	FSEFindSlotVisitor Visitor{FoundSlots};
 	FPlatformFileManager::Get().GetPlatformFile().IterateDirectory(*FSEFileHelpers::GetSaveFolder(), Visitor);
+	Visitor.Interrupted.RemoveAll([&FoundSlots](const FString& SlotName) {
+		return FoundSlots.Contains(SlotName);
+	});
+	for (FString& SlotName : RecoverFilesSync(MoveTemp(Visitor.Interrupted)))
+	{
+		FoundSlots.AddUnique(MoveTemp(SlotName));
+	}
+}
+
+TArray<FString> FSEFileHelpers::RecoverFilesSync(TArray<FString> SlotNames)
+{
+	if (SlotNames.IsEmpty())
+	{
+		return {};
+	}
+
+	auto Recover = [SlotNames = MoveTemp(SlotNames)]() {
+		TArray<FString> Recovered;
+		for (const FString& SlotName : SlotNames)
+		{
+			if (RecoverFileSync(SlotName))
+			{
+				Recovered.Add(SlotName);
+			}
+		}
+		return Recovered;
+	};
+	if (BackendPipe.IsInContext())
+	{
+		return Recover();
+	}
+	return BackendPipe.Launch(TEXT("RecoverFiles"), MoveTemp(Recover)).GetResult();
+}
+
+bool FSEFileHelpers::RecoverFileSync(FStringView SlotName)
+{
+	IFileManager& FileManager = IFileManager::Get();
+	const FString FilePath = GetSlotPath(SlotName);
+	const FString TempFilePath = GetTempSlotPath(SlotName);
+	if (FileManager.FileSize(*FilePath) >= 0 || FileManager.FileSize(*TempFilePath) < 0)
+	{
+		return false;
+	}
+
+	{	 // Only complete files can be recovered
+		FScopedFileReader Reader(TempFilePath, FILEREAD_Silent);
+		if (!Reader.IsValid())
+		{
+			return false;
+		}
+		FSaveFile File{};
+		File.Read(Reader, true);
+		if (File.IsEmpty() || File.bCorrupted || Reader.GetArchive().IsError() ||
+			(File.IsChunked() && File.Chunks.IsEmpty()))
+		{
+			UE_LOG(LogSaveExtension, Warning, TEXT("Found an incomplete save file '%s'"), *TempFilePath);
+			return false;
+		}
+	}
+
+	UE_LOG(LogSaveExtension, Log, TEXT("Recovering slot '%s' from an interrupted save"), SlotName.GetData());
+	return FileManager.Move(*FilePath, *TempFilePath, false, true);
+}
+
+UE::Tasks::TTask<int32> FSEFileHelpers::CollectBlobs()
+{
+	return BackendPipe.Launch(TEXT("CollectBlobs"), []() {
+		return CollectBlobsSync();
+	});
+}
+
+int32 FSEFileHelpers::CollectBlobsSync()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::CollectBlobsSync);
+	IFileManager& FileManager = IFileManager::Get();
+	const FString BlobFolder = GetSaveFolder() / TEXT("Blobs");
+	TArray<FString> BlobFiles;
+	FileManager.FindFiles(BlobFiles, *(BlobFolder / TEXT("*.blob.tmp")), true, false);
+	for (const FString& BlobFile : BlobFiles)
+	{
+		// Left behind by an interrupted save
+		FileManager.Delete(*(BlobFolder / BlobFile), false, false, true);
+	}
+	BlobFiles.Reset();
+	FileManager.FindFiles(BlobFiles, *(BlobFolder / TEXT("*.blob")), true, false);
+	if (BlobFiles.IsEmpty())
+	{
+		return 0;
+	}
+
+	// Slots, their temporary files and the files kept by delta saves can reference blobs.
+	// Journals are read with their slot.
+	TArray<FString> Files;
+	FileManager.FindFiles(Files, *(GetSaveFolder() / TEXT("*.sav*")), true, false);
+	Files.RemoveAll([](const FString& File) {
+		return File.EndsWith(TEXT(".log"));
+	});
+
+	FCriticalSection ReferencedLock;
+	TSet<FString> ReferencedBlobs;
+	std::atomic<bool> bAllRead{true};
+	ParallelFor(Files.Num(), [&](int32 Index) {
+		FScopedFileReader Reader(GetSaveFolder() / Files[Index], FILEREAD_Silent);
+		FSaveFile File{};
+		if (Reader.IsValid())
+		{
+			File.Read(Reader, true);
+		}
+		if (!Reader.IsValid() || File.bCorrupted)
+		{
+			bAllRead = false;
+			return;
+		}
+
+		FScopeLock ScopeLock(&ReferencedLock);
+		for (const FSaveFileChunk& Chunk : File.Chunks)
+		{
+			if (!Chunk.BlobHash.IsZero())
+			{
+				ReferencedBlobs.Add(FPaths::GetCleanFilename(GetBlobPath(Chunk.BlobHash)));
+			}
+		}
+	});
+	if (!bAllRead)
+	{
+		// A blob may be referenced by a file we couldn't read. Better to keep them all
+		UE_LOG(LogSaveExtension, Warning, TEXT("Unused blobs were not deleted. Some save files could not be read"));
+		return 0;
+	}
+
+	int32 Count = 0;
+	for (const FString& BlobFile : BlobFiles)
+	{
+		if (!ReferencedBlobs.Contains(BlobFile) && FileManager.Delete(*(BlobFolder / BlobFile), false, false, true))
+		{
+			++Count;
+		}
+	}
+	return Count;
+}
+
+bool FSEFileHelpers::VerifyFileSync(FStringView FilePath)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEFileHelpers::VerifyFileSync);
+	FScopedFileReader Reader(FilePath);
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	FSaveFile File{};
+	File.Read(Reader, true);
+	if (File.IsEmpty() || File.bCorrupted)
+	{
+		return false;
+	}
+
+	// Read one at a time to keep memory bound
+	for (FSaveFileChunk& Chunk : File.Chunks)
+	{
+		if (!FSaveFile::ReadChunk(Reader, Chunk))
+		{
+			return false;
+		}
+		Chunk.Bytes.Empty();
+	}
+	return true;
 }
 
 UObject* FSEFileHelpers::DeserializeObject(
 	UObject* Hint, FStringView ClassName, const UObject* Outer, const TArray<uint8>& Bytes)
 {
-	UObject* Object = Hint;
-
 	if (ClassName.IsEmpty() || Bytes.Num() <= 0)
+	{
+		return Hint;
+	}
+
+	UObject* Object = FindOrCreateObject(Hint, ClassName, Outer);
+	if (Object)
+	{
+		FMemoryReader Reader{Bytes};
+		FSEArchive Ar(Reader, true);
+		Object->Serialize(Ar);
+	}
+	return Object;
+}
+
+UObject* FSEFileHelpers::FindOrCreateObject(UObject* Hint, FStringView ClassName, const UObject* Outer)
+{
+	UObject* Object = Hint;
+	if (ClassName.IsEmpty())
 	{
 		return Object;
 	}
@@ -383,11 +2443,6 @@ UObject* FSEFileHelpers::DeserializeObject(
 
 		Object = NewObject<UObject>(const_cast<UObject*>(Outer), ObjectClass);
 	}
-
-	check(Object);
-	FMemoryReader Reader{Bytes};
-	FSEArchive Ar(Reader, true);
-	Object->Serialize(Ar);
 	return Object;
 }
 
@@ -0,0 +1,1147 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#include "SEPackFile.h"
+
+#include "SEFileHelpers.h"
+#include "SaveExtension.h"
+
+#include <HAL/PlatformFileManager.h>
+#include <Hash/xxhash.h>
+#include <Misc/CommandLine.h>
+#include <Misc/Paths.h>
+#include <Misc/ScopeLock.h>
+#include <Serialization/MemoryReader.h>
+#include <Serialization/MemoryWriter.h>
+
+
+static const uint32 SE_PACK_FILE_TAG = 0x5345506B;	  // "SEPk"
+static const int32 SE_PACK_FILE_VERSION = 1;
+// Tag, version, table offset, table size and table hash
+static const int64 SE_PACK_HEADER_SIZE = 32;
+// Packs are defragmented once this much of them is free
+static const int64 SE_PACK_DEFRAGMENT_MIN_SIZE = 1024 * 1024;
+static const double SE_PACK_DEFRAGMENT_RATIO = 0.25;
+// Files being written reserve at least this much space, doubled each time they need more
+static const int64 SE_PACK_MIN_EXTENT_SIZE = 64 * 1024;
+// Files are moved and imported in pieces of this size
+static const int64 SE_PACK_COPY_SIZE = 1024 * 1024;
+
+static TUniquePtr<FSEPackPlatformFile> MountedPack;
+
+
+/** Reads a file of a pack. Its space is not reused while open, even if the file is deleted or replaced */
+class FSEPackReadHandle : public IFileHandle
+{
+	FSEPackPlatformFile& Pack;
+	int64 Offset = 0;
+	int64 FileSize = 0;
+	int64 Position = 0;
+
+public:
+	FSEPackReadHandle(FSEPackPlatformFile& InPack, const FSEPackEntry& Entry)
+		: Pack(InPack)
+		, Offset(Entry.Offset)
+		, FileSize(Entry.Size)
+	{}
+	virtual ~FSEPackReadHandle() override
+	{
+		if (FileSize > 0)
+		{
+			Pack.CloseReader(Offset);
+		}
+	}
+
+	virtual int64 Tell() override
+	{
+		return Position;
+	}
+	virtual bool Seek(int64 NewPosition) override
+	{
+		if (NewPosition < 0 || NewPosition > FileSize)
+		{
+			return false;
+		}
+		Position = NewPosition;
+		return true;
+	}
+	virtual bool SeekFromEnd(int64 NewPositionRelativeToEnd = 0) override
+	{
+		return Seek(FileSize + NewPositionRelativeToEnd);
+	}
+	virtual bool Read(uint8* Destination, int64 BytesToRead) override
+	{
+		if (BytesToRead < 0 || Position + BytesToRead > FileSize ||
+			!Pack.ReadAt(Offset + Position, Destination, BytesToRead))
+		{
+			return false;
+		}
+		Position += BytesToRead;
+		return true;
+	}
+	virtual bool Write(const uint8* Source, int64 BytesToWrite) override
+	{
+		return false;
+	}
+	virtual bool Flush(const bool bFullFlush = false) override
+	{
+		return true;
+	}
+	virtual bool Truncate(int64 NewSize) override
+	{
+		return false;
+	}
+	virtual int64 Size() override
+	{
+		return FileSize;
+	}
+
+	/** Drops what was written since the last flush. The committed version is kept */
+	void Discard()
+	{
+		bDirty = false;
+	}
+};
+
+
+/** Writes a file of a pack straight into an extent reserved for it, which grows as data is written. The table
+ * points to the written bytes when flushed or closed
+ */
+class FSEPackWriteHandle : public IFileHandle
+{
+	FSEPackPlatformFile& Pack;
+	FString Name;
+	// Extent reserved for the file. INDEX_NONE until something is written
+	int64 Offset = INDEX_NONE;
+	int64 Capacity = 0;
+	int64 FileSize = 0;
+	int64 Position = 0;
+	// Bytes the committed table points to. They are never overwritten
+	int64 CommittedOffset = INDEX_NONE;
+	int64 CommittedSize = 0;
+	// Files opened to append keep the space reserved after them, so that the next append doesn't move them
+	bool bAppend = false;
+	bool bDirty = false;
+
+public:
+	FSEPackWriteHandle(FSEPackPlatformFile& InPack, FString InName, bool bInAppend, const FSEPackEntry* AppendedEntry)
+		: Pack(InPack)
+		, Name(MoveTemp(InName))
+		, bAppend(bInAppend)
+		, bDirty(AppendedEntry == nullptr)
+	{
+		if (AppendedEntry && AppendedEntry->Size > 0)
+		{
+			// Appended in place while the space after the file is free
+			Offset = AppendedEntry->Offset;
+			Capacity = FMath::Max(AppendedEntry->Size, AppendedEntry->Capacity);
+			FileSize = AppendedEntry->Size;
+			Position = FileSize;
+			CommittedOffset = Offset;
+			CommittedSize = FileSize;
+			Pack.ReserveExtent(Offset, Capacity);
+		}
+	}
+	virtual ~FSEPackWriteHandle() override
+	{
+		Flush();
+		if (Offset != INDEX_NONE)
+		{
+			// Space after the file is free again
+			Pack.UnreserveExtent(Offset);
+		}
+	}
+
+	virtual int64 Tell() override
+	{
+		return Position;
+	}
+	virtual bool Seek(int64 NewPosition) override
+	{
+		if (NewPosition < 0 || NewPosition > FileSize)
+		{
+			return false;
+		}
+		Position = NewPosition;
+		return true;
+	}
+	virtual bool SeekFromEnd(int64 NewPositionRelativeToEnd = 0) override
+	{
+		return Seek(FileSize + NewPositionRelativeToEnd);
+	}
+	virtual bool Read(uint8* Destination, int64 BytesToRead) override
+	{
+		if (BytesToRead < 0 || Position + BytesToRead > FileSize ||
+			(BytesToRead > 0 && !Pack.ReadAt(Offset + Position, Destination, BytesToRead)))
+		{
+			return false;
+		}
+		Position += BytesToRead;
+		return true;
+	}
+	virtual bool Write(const uint8* Source, int64 BytesToWrite) override
+	{
+		if (BytesToWrite < 0)
+		{
+			return false;
+		}
+		if (BytesToWrite == 0)
+		{
+			return true;
+		}
+		// Patching bytes of the committed version moves the file first, so that the table stays valid
+		const bool bMove = Offset == CommittedOffset && Position < CommittedSize;
+		if ((bMove || Position + BytesToWrite > Capacity) &&
+			!Pack.GrowExtent(Offset, Capacity, FileSize, Position + BytesToWrite, bMove))
+		{
+			return false;
+		}
+		if (!Pack.WriteAt(Offset + Position, Source, BytesToWrite))
+		{
+			return false;
+		}
+		Position += BytesToWrite;
+		FileSize = FMath::Max(FileSize, Position);
+		bDirty = true;
+		return true;
+	}
+	virtual bool Flush(const bool bFullFlush = false) override
+	{
+		if (bDirty)
+		{
+			if (!Pack.CommitFile(Name, Offset, FileSize, bAppend ? Capacity : 0))
+			{
+				return false;
+			}
+			CommittedOffset = Offset;
+			CommittedSize = FileSize;
+			bDirty = false;
+		}
+		return !bFullFlush || Pack.FlushPack(true);
+	}
+	virtual bool Truncate(int64 NewSize) override
+	{
+		if (NewSize < 0)
+		{
+			return false;
+		}
+		const int64 PreviousPosition = Position;
+		if (NewSize > FileSize)
+		{
+			// Filled with zeros, written in pieces
+			static const uint8 Zeros[4096]{};
+			Position = FileSize;
+			while (Position < NewSize)
+			{
+				if (!Write(Zeros, FMath::Min<int64>(NewSize - Position, sizeof(Zeros))))
+				{
+					return false;
+				}
+			}
+		}
+		FileSize = NewSize;
+		Position = FMath::Min(PreviousPosition, NewSize);
+		bDirty = true;
+		return true;
+	}
+	virtual int64 Size() override
+	{
+		return FileSize;
+	}
+
+	/** Drops what was written since the last flush. The committed version is kept */
+	void Discard()
+	{
+		bDirty = false;
+	}
+};
+
+
+FSEPackPlatformFile::FSEPackPlatformFile(FString InPackPath, FString InFolder)
+	: PackPath(MoveTemp(InPackPath))
+	, Folder(FPaths::ConvertRelativePathToFull(InFolder))
+{
+	FPaths::NormalizeDirectoryName(Folder);
+	Folder += TEXT("/");
+}
+
+FSEPackPlatformFile::~FSEPackPlatformFile()
+{
+	FScopeLock ScopeLock(&Lock);
+	PackHandle.Reset();
+}
+
+bool FSEPackPlatformFile::Mount()
+{
+	if (MountedPack)
+	{
+		return true;
+	}
+
+	auto Pack = MakeUnique<FSEPackPlatformFile>(
+		FPaths::ProjectSavedDir() / TEXT("SaveGames.pack"), FSEFileHelpers::GetSaveFolder());
+	if (!Pack->Initialize(&FPlatformFileManager::Get().GetPlatformFile(), FCommandLine::Get()))
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Save pack '%s' could not be opened. Loose files will be used"),
+			*Pack->PackPath);
+		return false;
+	}
+	FPlatformFileManager::Get().SetPlatformFile(*Pack);
+	MountedPack = MoveTemp(Pack);
+	return true;
+}
+
+void FSEPackPlatformFile::Unmount()
+{
+	if (MountedPack)
+	{
+		// Saves and defragmentation in progress still use it
+		FSEFileHelpers::GetPipe().WaitUntilEmpty();
+		FPlatformFileManager::Get().RemovePlatformFile(MountedPack.Get());
+		MountedPack.Reset();
+	}
+}
+
+FSEPackPlatformFile* FSEPackPlatformFile::Get()
+{
+	return MountedPack.Get();
+}
+
+int64 FSEPackPlatformFile::Defragment()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEPackPlatformFile::Defragment);
+
+	int64 PreviousSize = 0;
+	{
+		FScopeLock ScopeLock(&Lock);
+		bDefragmentQueued = false;
+		PreviousSize = PackHandle->Size();
+		// Space kept for appends is given back
+		for (TPair<FString, FSEPackEntry>& Entry : Entries)
+		{
+			if (!OpenExtents.Contains(Entry.Value.Offset))
+			{
+				Entry.Value.Capacity = 0;
+			}
+		}
+	}
+
+	// Extents left by moved files are only free once the table is committed. Each pass moves files into the
+	// space freed by the previous one
+	bool bMoved = true;
+	while (bMoved)
+	{
+		TArray<FString> Names;
+		{
+			FScopeLock ScopeLock(&Lock);
+			Entries.GetKeys(Names);
+			Names.Sort([this](const FString& A, const FString& B) {
+				return Entries[A].Offset < Entries[B].Offset;
+			});
+		}
+
+		// Files are moved to the first free space before them, one at a time so that the pack can be used
+		// meanwhile. The table is committed once for all of them
+		int32 NumMoved = 0;
+		for (const FString& Name : Names)
+		{
+			FScopeLock ScopeLock(&Lock);
+			FSEPackEntry* Entry = Entries.Find(Name);
+			if (!Entry || Entry->Size <= 0 || Readers.Contains(Entry->Offset) ||
+				OpenExtents.Contains(Entry->Offset))
+			{
+				continue;
+			}
+
+			const int64 Offset = Allocate(Entry->Size);
+			if (Offset >= Entry->Offset)
+			{
+				continue;
+			}
+			if (!CopyExtent(Entry->Offset, Offset, Entry->Size))
+			{
+				break;
+			}
+			// The previous copy stays valid until the table pointing to the new one is written
+			ReleaseExtent(*Entry);
+			Entry->Offset = Offset;
+			++NumMoved;
+		}
+
+		// If it fails, moved files keep their new copy. Previous copies stay reserved until a table is committed
+		FScopeLock ScopeLock(&Lock);
+		bMoved = NumMoved > 0 && CommitTable();
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	// Moves the table too, if there is space before it
+	CommitTable();
+
+	int64 End = SE_PACK_HEADER_SIZE;
+	for (const TPair<int64, int64>& Extent : GetUsedExtents())
+	{
+		End = FMath::Max(End, Extent.Key + Extent.Value);
+	}
+	if (End < PackHandle->Size())
+	{
+		PackHandle->Truncate(End);
+	}
+	return PreviousSize - PackHandle->Size();
+}
+
+int64 FSEPackPlatformFile::GetFreeSpace() const
+{
+	FScopeLock ScopeLock(&Lock);
+	int64 Used = SE_PACK_HEADER_SIZE;
+	for (const TPair<int64, int64>& Extent : GetUsedExtents())
+	{
+		Used += Extent.Value;
+	}
+	return FMath::Max<int64>(PackHandle->Size() - Used, 0);
+}
+
+int64 FSEPackPlatformFile::GetPackSize() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return PackHandle->Size();
+}
+
+bool FSEPackPlatformFile::Initialize(IPlatformFile* Inner, const TCHAR* CmdLine)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEPackPlatformFile::Initialize);
+	check(Inner);
+	LowerLevel = Inner;
+
+	FScopeLock ScopeLock(&Lock);
+	LowerLevel->CreateDirectoryTree(*FPaths::GetPath(PackPath));
+	const bool bExists = LowerLevel->FileSize(*PackPath) > 0;
+	// Opened to append so that its contents are kept. Writes still go where the handle is seeked to
+	PackHandle.Reset(LowerLevel->OpenWrite(*PackPath, true, true));
+	if (!PackHandle)
+	{
+		return false;
+	}
+
+	if (bExists ? !ReadHeader() : !CommitTable())
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Save pack '%s' is not valid"), *PackPath);
+		PackHandle.Reset();
+		return false;
+	}
+
+	ImportFolder();
+	return true;
+}
+
+bool FSEPackPlatformFile::FileExists(const TCHAR* Filename)
+{
+	FString Name;
+	if (!GetPackName(Filename, Name))
+	{
+		return LowerLevel->FileExists(Filename);
+	}
+	FScopeLock ScopeLock(&Lock);
+	return Entries.Contains(Name);
+}
+
+int64 FSEPackPlatformFile::FileSize(const TCHAR* Filename)
+{
+	FString Name;
+	if (!GetPackName(Filename, Name))
+	{
+		return LowerLevel->FileSize(Filename);
+	}
+	FScopeLock ScopeLock(&Lock);
+	const FSEPackEntry* Entry = Entries.Find(Name);
+	return Entry ? Entry->Size : INDEX_NONE;
+}
+
+bool FSEPackPlatformFile::DeleteFile(const TCHAR* Filename)
+{
+	FString Name;
+	if (!GetPackName(Filename, Name))
+	{
+		return LowerLevel->DeleteFile(Filename);
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	FSEPackEntry Entry;
+	if (!Entries.RemoveAndCopyValue(Name, Entry))
+	{
+		return false;
+	}
+	ReleaseExtent(Entry);
+	const bool bCommitted = CommitTable();
+	QueueDefragment();
+	return bCommitted;
+}
+
+bool FSEPackPlatformFile::IsReadOnly(const TCHAR* Filename)
+{
+	FString Name;
+	return GetPackName(Filename, Name) ? false : LowerLevel->IsReadOnly(Filename);
+}
+
+bool FSEPackPlatformFile::MoveFile(const TCHAR* To, const TCHAR* From)
+{
+	FString ToName;
+	FString FromName;
+	const bool bToPack = GetPackName(To, ToName);
+	const bool bFromPack = GetPackName(From, FromName);
+	if (!bToPack && !bFromPack)
+	{
+		return LowerLevel->MoveFile(To, From);
+	}
+	if (bToPack != bFromPack)
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Files can't be moved in or out of the save pack ('%s' to '%s')"),
+			From, To);
+		return false;
+	}
+
+	// Only the table changes
+	FScopeLock ScopeLock(&Lock);
+	FSEPackEntry Entry;
+	if (!Entries.RemoveAndCopyValue(FromName, Entry))
+	{
+		return false;
+	}
+	if (const FSEPackEntry* Replaced = Entries.Find(ToName))
+	{
+		ReleaseExtent(*Replaced);
+	}
+	Entries.Add(ToName, Entry);
+	return CommitTable();
+}
+
+bool FSEPackPlatformFile::SetReadOnly(const TCHAR* Filename, bool bNewReadOnlyValue)
+{
+	FString Name;
+	return GetPackName(Filename, Name) ? !bNewReadOnlyValue : LowerLevel->SetReadOnly(Filename, bNewReadOnlyValue);
+}
+
+FDateTime FSEPackPlatformFile::GetTimeStamp(const TCHAR* Filename)
+{
+	FString Name;
+	if (!GetPackName(Filename, Name))
+	{
+		return LowerLevel->GetTimeStamp(Filename);
+	}
+	FScopeLock ScopeLock(&Lock);
+	const FSEPackEntry* Entry = Entries.Find(Name);
+	return Entry ? Entry->ModificationTime : FDateTime::MinValue();
+}
+
+void FSEPackPlatformFile::SetTimeStamp(const TCHAR* Filename, FDateTime DateTime)
+{
+	FString Name;
+	if (!GetPackName(Filename, Name))
+	{
+		LowerLevel->SetTimeStamp(Filename, DateTime);
+		return;
+	}
+	FScopeLock ScopeLock(&Lock);
+	if (FSEPackEntry* Entry = Entries.Find(Name))
+	{
+		Entry->ModificationTime = DateTime;
+		CommitTable();
+	}
+}
+
+FDateTime FSEPackPlatformFile::GetAccessTimeStamp(const TCHAR* Filename)
+{
+	FString Name;
+	return GetPackName(Filename, Name) ? GetTimeStamp(Filename) : LowerLevel->GetAccessTimeStamp(Filename);
+}
+
+FString FSEPackPlatformFile::GetFilenameOnDisk(const TCHAR* Filename)
+{
+	FString Name;
+	return GetPackName(Filename, Name) ? FString{Filename} : LowerLevel->GetFilenameOnDisk(Filename);
+}
+
+IFileHandle* FSEPackPlatformFile::OpenRead(const TCHAR* Filename, bool bAllowWrite)
+{
+	FString Name;
+	if (!GetPackName(Filename, Name))
+	{
+		return LowerLevel->OpenRead(Filename, bAllowWrite);
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	const FSEPackEntry* Entry = Entries.Find(Name);
+	if (!Entry)
+	{
+		return nullptr;
+	}
+	if (Entry->Size > 0)
+	{
+		++Readers.FindOrAdd(Entry->Offset);
+	}
+	return new FSEPackReadHandle(*this, *Entry);
+}
+
+IFileHandle* FSEPackPlatformFile::OpenWrite(const TCHAR* Filename, bool bAppend, bool bAllowRead)
+{
+	FString Name;
+	if (!GetPackName(Filename, Name))
+	{
+		return LowerLevel->OpenWrite(Filename, bAppend, bAllowRead);
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	const FSEPackEntry* Entry = bAppend ? Entries.Find(Name) : nullptr;
+	return new FSEPackWriteHandle(*this, MoveTemp(Name), bAppend, Entry);
+}
+
+IMappedFileHandle* FSEPackPlatformFile::OpenMapped(const TCHAR* Filename)
+{
+	FString Name;
+	return GetPackName(Filename, Name) ? nullptr : LowerLevel->OpenMapped(Filename);
+}
+
+bool FSEPackPlatformFile::DirectoryExists(const TCHAR* Directory)
+{
+	FString Name;
+	if (!GetPackName(Directory, Name))
+	{
+		return LowerLevel->DirectoryExists(Directory);
+	}
+	if (Name.IsEmpty())
+	{
+		return true;
+	}
+
+	const FString Prefix = Name / TEXT("");
+	FScopeLock ScopeLock(&Lock);
+	for (const TPair<FString, FSEPackEntry>& Entry : Entries)
+	{
+		if (Entry.Key.StartsWith(Prefix))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FSEPackPlatformFile::CreateDirectory(const TCHAR* Directory)
+{
+	// Directories of the pack exist while they have files
+	FString Name;
+	return GetPackName(Directory, Name) || LowerLevel->CreateDirectory(Directory);
+}
+
+bool FSEPackPlatformFile::DeleteDirectory(const TCHAR* Directory)
+{
+	FString Name;
+	if (!GetPackName(Directory, Name))
+	{
+		return LowerLevel->DeleteDirectory(Directory);
+	}
+	return !DirectoryExists(Directory);
+}
+
+FFileStatData FSEPackPlatformFile::GetStatData(const TCHAR* FilenameOrDirectory)
+{
+	FString Name;
+	if (!GetPackName(FilenameOrDirectory, Name))
+	{
+		return LowerLevel->GetStatData(FilenameOrDirectory);
+	}
+
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (const FSEPackEntry* Entry = Entries.Find(Name))
+		{
+			const FDateTime Time = Entry->ModificationTime;
+			return FFileStatData{Time, Time, Time, Entry->Size, false, false};
+		}
+	}
+	if (DirectoryExists(FilenameOrDirectory))
+	{
+		return FFileStatData{FDateTime::MinValue(), FDateTime::MinValue(), FDateTime::MinValue(), -1, true, false};
+	}
+	return {};
+}
+
+bool FSEPackPlatformFile::IterateDirectory(const TCHAR* Directory, FDirectoryVisitor& Visitor)
+{
+	FString Name;
+	if (!GetPackName(Directory, Name))
+	{
+		return LowerLevel->IterateDirectory(Directory, Visitor);
+	}
+
+	TArray<TPair<FString, FFileStatData>> Contents;
+	{
+		FScopeLock ScopeLock(&Lock);
+		GetDirectoryContents(Name, Contents);
+	}
+	// Visited unlocked. Visitors can read the files they find
+	for (const TPair<FString, FFileStatData>& Item : Contents)
+	{
+		if (!Visitor.CallShouldVisitAndVisit(*Item.Key, Item.Value.bIsDirectory))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FSEPackPlatformFile::IterateDirectoryStat(const TCHAR* Directory, FDirectoryStatVisitor& Visitor)
+{
+	FString Name;
+	if (!GetPackName(Directory, Name))
+	{
+		return LowerLevel->IterateDirectoryStat(Directory, Visitor);
+	}
+
+	TArray<TPair<FString, FFileStatData>> Contents;
+	{
+		FScopeLock ScopeLock(&Lock);
+		GetDirectoryContents(Name, Contents);
+	}
+	for (const TPair<FString, FFileStatData>& Item : Contents)
+	{
+		if (!Visitor.CallShouldVisitAndVisit(*Item.Key, Item.Value))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FSEPackPlatformFile::GetPackName(const TCHAR* Path, FString& OutName) const
+{
+	FString FullPath = FPaths::ConvertRelativePathToFull(Path);
+	FPaths::NormalizeFilename(FullPath);
+	if (FullPath.Len() + 1 == Folder.Len() && Folder.StartsWith(FullPath))
+	{
+		// The folder itself
+		OutName.Reset();
+		return true;
+	}
+	if (!FullPath.StartsWith(Folder))
+	{
+		return false;
+	}
+	OutName = FullPath.RightChop(Folder.Len());
+	OutName.RemoveFromEnd(TEXT("/"));
+	return true;
+}
+
+bool FSEPackPlatformFile::ReadHeader()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEPackPlatformFile::ReadHeader);
+	const int64 PackSize = PackHandle->Size();
+
+	uint8 HeaderBytes[SE_PACK_HEADER_SIZE];
+	if (!PackHandle->Seek(0) || !PackHandle->Read(HeaderBytes, SE_PACK_HEADER_SIZE))
+	{
+		return false;
+	}
+	FMemoryReaderView HeaderReader({HeaderBytes, SE_PACK_HEADER_SIZE});
+	uint32 Tag = 0;
+	int32 Version = 0;
+	int64 Offset = 0;
+	int64 Size = 0;
+	uint64 Hash = 0;
+	HeaderReader << Tag;
+	HeaderReader << Version;
+	HeaderReader << Offset;
+	HeaderReader << Size;
+	HeaderReader << Hash;
+	if (Tag != SE_PACK_FILE_TAG || Version > SE_PACK_FILE_VERSION || Offset < SE_PACK_HEADER_SIZE || Size < 0 ||
+		Offset + Size > PackSize || Size > MAX_int32)
+	{
+		return false;
+	}
+
+	TArray<uint8> TableBytes;
+	TableBytes.SetNumUninitialized(int32(Size));
+	if (!PackHandle->Seek(Offset) || !PackHandle->Read(TableBytes.GetData(), Size) ||
+		FXxHash64::HashBuffer(TableBytes.GetData(), Size).Hash != Hash)
+	{
+		return false;
+	}
+
+	FMemoryReader TableReader(TableBytes);
+	TableReader << Entries;
+	for (const TPair<FString, FSEPackEntry>& Entry : Entries)
+	{
+		if (Entry.Value.Size < 0 || Entry.Value.Offset < 0 || Entry.Value.Offset + Entry.Value.Size > PackSize)
+		{
+			TableReader.SetError();
+		}
+	}
+	if (TableReader.IsError())
+	{
+		Entries.Reset();
+		return false;
+	}
+	TableOffset = Offset;
+	TableSize = Size;
+	return true;
+}
+
+bool FSEPackPlatformFile::CommitTable()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEPackPlatformFile::CommitTable);
+
+	TArray<uint8> TableBytes;
+	FMemoryWriter TableWriter(TableBytes);
+	TableWriter << Entries;
+
+	// Written to free space. The previous table stays valid until the header points to the new one
+	int64 Offset = Allocate(TableBytes.Num());
+	if (!PackHandle->Seek(Offset) || !PackHandle->Write(TableBytes.GetData(), TableBytes.Num()) ||
+		!PackHandle->Flush())
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Failed to write the table of save pack '%s'"), *PackPath);
+		return false;
+	}
+
+	TArray<uint8> HeaderBytes;
+	FMemoryWriter HeaderWriter(HeaderBytes);
+	uint32 Tag = SE_PACK_FILE_TAG;
+	int32 Version = SE_PACK_FILE_VERSION;
+	int64 Size = TableBytes.Num();
+	uint64 Hash = FXxHash64::HashBuffer(TableBytes.GetData(), Size).Hash;
+	HeaderWriter << Tag;
+	HeaderWriter << Version;
+	HeaderWriter << Offset;
+	HeaderWriter << Size;
+	HeaderWriter << Hash;
+	check(HeaderBytes.Num() == SE_PACK_HEADER_SIZE);
+	if (!PackHandle->Seek(0) || !PackHandle->Write(HeaderBytes.GetData(), HeaderBytes.Num()) ||
+		!PackHandle->Flush())
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Failed to write the header of save pack '%s'"), *PackPath);
+		return false;
+	}
+
+	TableOffset = Offset;
+	TableSize = Size;
+
+	// Nothing points to released extents anymore. Those still being read are freed by their last reader
+	for (auto It = RetiredExtents.CreateIterator(); It; ++It)
+	{
+		if (!Readers.Contains(It.Key()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+	return true;
+}
+
+int64 FSEPackPlatformFile::Allocate(int64 Size) const
+{
+	int64 Start = SE_PACK_HEADER_SIZE;
+	if (Size <= 0)
+	{
+		return Start;
+	}
+
+	// First fit
+	for (const TPair<int64, int64>& Extent : GetUsedExtents())
+	{
+		if (Extent.Key - Start >= Size)
+		{
+			return Start;
+		}
+		Start = FMath::Max(Start, Extent.Key + Extent.Value);
+	}
+	return Start;
+}
+
+TArray<TPair<int64, int64>> FSEPackPlatformFile::GetUsedExtents() const
+{
+	TArray<TPair<int64, int64>> Extents;
+	Extents.Reserve(Entries.Num() + RetiredExtents.Num() + OpenExtents.Num() + 1);
+	for (const TPair<FString, FSEPackEntry>& Entry : Entries)
+	{
+		const int64 Size = FMath::Max(Entry.Value.Size, Entry.Value.Capacity);
+		if (Size > 0)
+		{
+			Extents.Emplace(Entry.Value.Offset, Size);
+		}
+	}
+	for (const TPair<int64, int64>& Extent : RetiredExtents)
+	{
+		Extents.Add(Extent);
+	}
+	// Files being written may overlap their previous version
+	for (const TPair<int64, int64>& Extent : OpenExtents)
+	{
+		if (Extent.Value > 0)
+		{
+			Extents.Add(Extent);
+		}
+	}
+	if (TableSize > 0)
+	{
+		Extents.Emplace(TableOffset, TableSize);
+	}
+	Extents.Sort([](const TPair<int64, int64>& A, const TPair<int64, int64>& B) {
+		return A.Key < B.Key;
+	});
+	return Extents;
+}
+
+void FSEPackPlatformFile::ReserveExtent(int64 Offset, int64 Capacity)
+{
+	FScopeLock ScopeLock(&Lock);
+	OpenExtents.Add(Offset, Capacity);
+}
+
+void FSEPackPlatformFile::UnreserveExtent(int64 Offset)
+{
+	FScopeLock ScopeLock(&Lock);
+	OpenExtents.Remove(Offset);
+}
+
+bool FSEPackPlatformFile::GrowExtent(int64& Offset, int64& Capacity, int64 Size, int64 NeededSize, bool bMove)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEPackPlatformFile::GrowExtent);
+	FScopeLock ScopeLock(&Lock);
+
+	// Doubled, so that files written a bit at a time are rarely moved
+	const int64 NewCapacity = FMath::Max3(NeededSize, Capacity * 2, SE_PACK_MIN_EXTENT_SIZE);
+	if (Offset != INDEX_NONE && !bMove)
+	{
+		const int64 End = Offset + Capacity;
+		const int64 NewEnd = Offset + NewCapacity;
+		bool bFree = true;
+		for (const TPair<int64, int64>& Extent : GetUsedExtents())
+		{
+			// Extents at the same offset are the file itself
+			if (Extent.Key != Offset && Extent.Key < NewEnd && Extent.Key + Extent.Value > End)
+			{
+				bFree = false;
+				break;
+			}
+		}
+		if (bFree)
+		{
+			OpenExtents.Add(Offset, NewCapacity);
+			Capacity = NewCapacity;
+			return true;
+		}
+	}
+
+	// Moved to free space. Bytes written so far are copied, while the previous extent is still reserved
+	const int64 NewOffset = Allocate(NewCapacity);
+	if (Offset != INDEX_NONE && !CopyExtent(Offset, NewOffset, Size))
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Failed to move a file inside save pack '%s'"), *PackPath);
+		return false;
+	}
+	if (Offset != INDEX_NONE)
+	{
+		OpenExtents.Remove(Offset);
+	}
+	OpenExtents.Add(NewOffset, NewCapacity);
+	Offset = NewOffset;
+	Capacity = NewCapacity;
+	return true;
+}
+
+bool FSEPackPlatformFile::CommitFile(const FString& Name, int64 Offset, int64 Size, int64 Capacity)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEPackPlatformFile::CommitFile);
+	FScopeLock ScopeLock(&Lock);
+
+	FSEPackEntry Entry;
+	Entry.Offset = Size > 0 ? Offset : SE_PACK_HEADER_SIZE;
+	Entry.Size = Size;
+	Entry.Capacity = Capacity;
+	Entry.ModificationTime = FDateTime::UtcNow();
+	// Files appended in place keep their offset. Otherwise the previous version is never written over, and stays
+	// valid until the table is committed
+	const FSEPackEntry* Previous = Entries.Find(Name);
+	if (Previous && Previous->Offset != Entry.Offset)
+	{
+		ReleaseExtent(*Previous);
+	}
+	Entries.Add(Name, Entry);
+	const bool bCommitted = CommitTable();
+	QueueDefragment();
+	return bCommitted;
+}
+
+bool FSEPackPlatformFile::WriteAt(int64 Offset, const uint8* Source, int64 Size)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Size > 0 && (!PackHandle->Seek(Offset) || !PackHandle->Write(Source, Size)))
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Failed to write into save pack '%s'"), *PackPath);
+		return false;
+	}
+	return true;
+}
+
+bool FSEPackPlatformFile::CopyExtent(int64 From, int64 To, int64 Size)
+{
+	FScopeLock ScopeLock(&Lock);
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(int32(FMath::Min(Size, SE_PACK_COPY_SIZE)));
+	for (int64 Copied = 0; Copied < Size;)
+	{
+		const int64 Count = FMath::Min<int64>(Size - Copied, Buffer.Num());
+		if (!ReadAt(From + Copied, Buffer.GetData(), Count) || !WriteAt(To + Copied, Buffer.GetData(), Count))
+		{
+			return false;
+		}
+		Copied += Count;
+	}
+	return true;
+}
+
+bool FSEPackPlatformFile::ReadAt(int64 Offset, uint8* Destination, int64 Size)
+{
+	FScopeLock ScopeLock(&Lock);
+	return Size <= 0 || (PackHandle->Seek(Offset) && PackHandle->Read(Destination, Size));
+}
+
+bool FSEPackPlatformFile::FlushPack(bool bFullFlush)
+{
+	FScopeLock ScopeLock(&Lock);
+	return PackHandle->Flush(bFullFlush);
+}
+
+void FSEPackPlatformFile::ReleaseExtent(const FSEPackEntry& Entry)
+{
+	// Reserved until the next table is committed, since the current one may still point to it
+	if (Entry.Size > 0)
+	{
+		RetiredExtents.Add(Entry.Offset, Entry.Size);
+	}
+}
+
+void FSEPackPlatformFile::CloseReader(int64 Offset)
+{
+	FScopeLock ScopeLock(&Lock);
+	int32* Count = Readers.Find(Offset);
+	if (Count && --*Count <= 0)
+	{
+		// A retired extent is freed by the next commit, once no table on disk can point to it
+		Readers.Remove(Offset);
+	}
+}
+
+void FSEPackPlatformFile::ImportFolder()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEPackPlatformFile::ImportFolder);
+	if (!LowerLevel->DirectoryExists(*Folder))
+	{
+		return;
+	}
+
+	TArray<FString> Files;
+	LowerLevel->IterateDirectoryRecursively(*Folder, [&Files](const TCHAR* Path, bool bIsDirectory) {
+		if (!bIsDirectory)
+		{
+			Files.Add(Path);
+		}
+		return true;
+	});
+
+	// One file at a time, copied in pieces and deleted once it is in the pack
+	int32 NumImported = 0;
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(int32(SE_PACK_COPY_SIZE));
+	for (const FString& File : Files)
+	{
+		FString Name;
+		if (!GetPackName(*File, Name) || Entries.Contains(Name))
+		{
+			continue;
+		}
+		TUniquePtr<IFileHandle> Reader{LowerLevel->OpenRead(*File)};
+		if (!Reader)
+		{
+			continue;
+		}
+
+		bool bImported = true;
+		{
+			FSEPackWriteHandle Writer{*this, Name, false, nullptr};
+			for (int64 Remaining = Reader->Size(); Remaining > 0 && bImported;)
+			{
+				const int64 Count = FMath::Min<int64>(Remaining, Buffer.Num());
+				bImported = Reader->Read(Buffer.GetData(), Count) && Writer.Write(Buffer.GetData(), Count);
+				Remaining -= Count;
+			}
+			bImported = bImported && Writer.Flush();
+			if (!bImported)
+			{
+				Writer.Discard();
+			}
+		}
+		Reader.Reset();
+
+		if (bImported)
+		{
+			Entries[Name].ModificationTime = LowerLevel->GetTimeStamp(*File);
+			LowerLevel->DeleteFile(*File);
+			++NumImported;
+		}
+	}
+	if (NumImported > 0)
+	{
+		CommitTable();
+		UE_LOG(LogSaveExtension, Log, TEXT("Moved %i files into save pack '%s'"), NumImported, *PackPath);
+	}
+}
+
+void FSEPackPlatformFile::QueueDefragment()
+{
+	if (bDefragmentQueued || this != MountedPack.Get())
+	{
+		return;
+	}
+
+	const int64 FreeSpace = GetFreeSpace();
+	if (FreeSpace < SE_PACK_DEFRAGMENT_MIN_SIZE || FreeSpace < int64(GetPackSize() * SE_PACK_DEFRAGMENT_RATIO))
+	{
+		return;
+	}
+
+	bDefragmentQueued = true;
+	FSEFileHelpers::GetPipe().Launch(UE_SOURCE_LOCATION, []() {
+		if (FSEPackPlatformFile* Pack = FSEPackPlatformFile::Get())
+		{
+			Pack->Defragment();
+		}
+	});
+}
+
+void FSEPackPlatformFile::GetDirectoryContents(
+	const FString& Directory, TArray<TPair<FString, FFileStatData>>& OutContents) const
+{
+	const FString Prefix = Directory.IsEmpty() ? FString{} : Directory / TEXT("");
+	TSet<FString> Subdirectories;
+	for (const TPair<FString, FSEPackEntry>& Entry : Entries)
+	{
+		if (!Entry.Key.StartsWith(Prefix))
+		{
+			continue;
+		}
+
+		const FString Rest = Entry.Key.RightChop(Prefix.Len());
+		int32 SlashIndex = INDEX_NONE;
+		if (Rest.FindChar(TEXT('/'), SlashIndex))
+		{
+			const FString Subdirectory = Rest.Left(SlashIndex);
+			if (!Subdirectories.Contains(Subdirectory))
+			{
+				Subdirectories.Add(Subdirectory);
+				const FDateTime Time = FDateTime::MinValue();
+				OutContents.Emplace(Folder + Prefix + Subdirectory, FFileStatData{Time, Time, Time, -1, true, false});
+			}
+			continue;
+		}
+
+		const FDateTime Time = Entry.Value.ModificationTime;
+		OutContents.Emplace(Folder + Entry.Key, FFileStatData{Time, Time, Time, Entry.Value.Size, false, false});
+	}
+}
@@ -0,0 +1,338 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#include "SESlotCatalog.h"
+
+#include "SEFileHelpers.h"
+#include "SaveExtension.h"
+
+#include <Async/ParallelFor.h>
+#include <HAL/FileManager.h>
+#include <HAL/PlatformFileManager.h>
+#include <Misc/ScopeLock.h>
+
+
+static const int32 SE_SLOT_CATALOG_TAG = 0x53456349;	// "SEcI"
+static const int32 SE_SLOT_CATALOG_VERSION = 4;
+
+
+/** Collects save files with their size and modification time */
+class FSECatalogVisitor : public IPlatformFile::FDirectoryStatVisitor
+{
+public:
+	TMap<FString, FFileStatData> Files;
+	TMap<FString, int64> JournalSizes;
+	/** Slots with a temporary file left behind by an interrupted save. Recovered once listing finishes */
+	TArray<FString> Interrupted;
+
+	virtual bool Visit(const TCHAR* FilenameOrDirectory, const FFileStatData& StatData) override
+	{
+		if (StatData.bIsDirectory)
+		{
+			return true;
+		}
+
+		FString Filename = FPaths::GetCleanFilename(FilenameOrDirectory);
+		if (Filename.EndsWith(TEXT(".sav")))
+		{
+			Filename.LeftChopInline(4);
+			Files.Add(MoveTemp(Filename), StatData);
+		}
+		else if (Filename.EndsWith(TEXT(".sav.log")))
+		{
+			Filename.LeftChopInline(8);
+			JournalSizes.Add(MoveTemp(Filename), StatData.FileSize);
+		}
+		else if (Filename.EndsWith(TEXT(".sav.tmp")))
+		{
+			// Left behind by an interrupted save
+			Filename.LeftChopInline(8);
+			Interrupted.Add(MoveTemp(Filename));
+		}
+		return true;
+	}
+};
+
+
+FArchive& operator<<(FArchive& Ar, FSESlotCatalogEntry& Entry)
+{
+	Ar << Entry.Name;
+	Ar << Entry.ClassName;
+	Ar << Entry.InfoBytes;
+	Ar << Entry.FileSize;
+	Ar << Entry.ModificationTime;
+	Ar << Entry.JournalSize;
+	Ar << Entry.SaveDate;
+	Ar << Entry.ThumbnailOffset;
+	Ar << Entry.ThumbnailSize;
+	return Ar;
+}
+
+
+FSESlotCatalog& FSESlotCatalog::Get()
+{
+	static FSESlotCatalog Catalog;
+	return Catalog;
+}
+
+void FSESlotCatalog::Refresh()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSESlotCatalog::Refresh);
+	FSECatalogVisitor Visitor;
+	FPlatformFileManager::Get().GetPlatformFile().IterateDirectoryStat(*FSEFileHelpers::GetSaveFolder(), Visitor);
+	// Recovered before locking, since the pipe may be waiting for the catalog
+	Visitor.Interrupted.RemoveAll([&Visitor](const FString& SlotName) {
+		return Visitor.Files.Contains(SlotName);
+	});
+	for (FString& SlotName : FSEFileHelpers::RecoverFilesSync(MoveTemp(Visitor.Interrupted)))
+	{
+		FFileStatData RecoveredData = IFileManager::Get().GetStatData(*FSEFileHelpers::GetSlotPath(SlotName));
+		Visitor.Files.Add(MoveTemp(SlotName), RecoveredData);
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	LoadIndex();
+
+	bool bChanged = false;
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (!Visitor.Files.Contains(It.Key()))
+		{
+			It.RemoveCurrent();
+			bChanged = true;
+		}
+	}
+
+	TArray<FSESlotCatalogEntry> ChangedEntries;
+	for (const auto& File : Visitor.Files)
+	{
+		const FSESlotCatalogEntry* Entry = Entries.Find(File.Key);
+		const int64 JournalSize = Visitor.JournalSizes.FindRef(File.Key);
+		if (Entry && Entry->FileSize == File.Value.FileSize &&
+			Entry->ModificationTime == File.Value.ModificationTime && Entry->JournalSize == JournalSize)
+		{
+			continue;	 // Up to date
+		}
+
+		FSESlotCatalogEntry& NewEntry = ChangedEntries.AddDefaulted_GetRef();
+		NewEntry.Name = File.Key;
+		NewEntry.FileSize = File.Value.FileSize;
+		NewEntry.ModificationTime = File.Value.ModificationTime;
+		NewEntry.JournalSize = JournalSize;
+	}
+
+	if (!ChangedEntries.IsEmpty())
+	{
+		// Reading is bound by latency. Read all headers at once
+		TArray<bool> ReadEntries;
+		ReadEntries.SetNumZeroed(ChangedEntries.Num());
+		ParallelFor(ChangedEntries.Num(), [&ChangedEntries, &ReadEntries](int32 Index) {
+			ReadEntries[Index] = ReadEntry(ChangedEntries[Index]);
+		});
+
+		// Merged in a deterministic order
+		for (int32 Index = 0; Index < ChangedEntries.Num(); ++Index)
+		{
+			FSESlotCatalogEntry& Entry = ChangedEntries[Index];
+			if (ReadEntries[Index])
+			{
+				FString Name = Entry.Name;
+				Entries.Add(MoveTemp(Name), MoveTemp(Entry));
+			}
+			else
+			{
+				Entries.Remove(Entry.Name);
+			}
+		}
+		bChanged = true;
+	}
+
+	bRefreshed = true;
+	if (bChanged)
+	{
+		SaveIndex();
+	}
+}
+
+void FSESlotCatalog::GetEntries(TArray<FSESlotCatalogEntry>& OutEntries, bool bSortByRecent)
+{
+	Refresh();
+
+	TArray<FSESlotCatalogEntry> SortedEntries;
+	{
+		FScopeLock ScopeLock(&Lock);
+		Entries.GenerateValueArray(SortedEntries);
+	}
+
+	if (bSortByRecent)
+	{
+		SortedEntries.Sort([](const FSESlotCatalogEntry& A, const FSESlotCatalogEntry& B) {
+			return A.SaveDate > B.SaveDate || (A.SaveDate == B.SaveDate && A.Name < B.Name);
+		});
+	}
+	else
+	{
+		SortedEntries.Sort([](const FSESlotCatalogEntry& A, const FSESlotCatalogEntry& B) {
+			return A.Name < B.Name;
+		});
+	}
+	OutEntries.Append(MoveTemp(SortedEntries));
+}
+
+TOptional<bool> FSESlotCatalog::Contains(FStringView SlotName) const
+{
+	FScopeLock ScopeLock(&Lock);
+	if (!bRefreshed)
+	{
+		return {};
+	}
+	return Entries.Contains(FString{SlotName});
+}
+
+bool FSESlotCatalog::FindThumbnail(FStringView SlotName, int64& OutOffset, int64& OutSize) const
+{
+	FScopeLock ScopeLock(&Lock);
+	const FSESlotCatalogEntry* Entry = Entries.Find(FString{SlotName});
+	if (!Entry || Entry->ThumbnailSize <= 0 || Entry->ThumbnailOffset <= 0)
+	{
+		return false;
+	}
+	OutOffset = Entry->ThumbnailOffset;
+	OutSize = Entry->ThumbnailSize;
+	return true;
+}
+
+void FSESlotCatalog::Update(FStringView SlotName, const FSaveFile& File)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSESlotCatalog::Update);
+	const FFileStatData StatData = IFileManager::Get().GetStatData(*FSEFileHelpers::GetSlotPath(SlotName));
+	const int64 JournalSize = IFileManager::Get().FileSize(*FSEFileHelpers::GetJournalSlotPath(SlotName));
+
+	FScopeLock ScopeLock(&Lock);
+	LoadIndex();
+
+	const FString Name{SlotName};
+	if (!StatData.bIsValid)
+	{
+		Entries.Remove(Name);
+	}
+	else
+	{
+		FSESlotCatalogEntry& Entry = Entries.FindOrAdd(Name);
+		Entry.Name = Name;
+		Entry.FileSize = StatData.FileSize;
+		Entry.ModificationTime = StatData.ModificationTime;
+		Entry.JournalSize = FMath::Max<int64>(JournalSize, 0);
+		FillEntry(Entry, File);
+	}
+	SaveIndex();
+}
+
+void FSESlotCatalog::Remove(FStringView SlotName)
+{
+	FScopeLock ScopeLock(&Lock);
+	LoadIndex();
+	if (Entries.Remove(FString{SlotName}) > 0)
+	{
+		SaveIndex();
+	}
+}
+
+FString FSESlotCatalog::GetIndexPath()
+{
+	return FSEFileHelpers::GetSaveFolder() / TEXT("SlotCatalog.bin");
+}
+
+void FSESlotCatalog::LoadIndex()
+{
+	if (bLoaded)
+	{
+		return;
+	}
+	bLoaded = true;
+
+	FScopedFileReader Reader(GetIndexPath(), FILEREAD_Silent);
+	if (!Reader.IsValid())
+	{
+		return;
+	}
+
+	FArchive& Ar = Reader.GetArchive();
+	int32 Tag = 0;
+	int32 Version = 0;
+	Ar << Tag;
+	Ar << Version;
+	if (Tag != SE_SLOT_CATALOG_TAG || Version != SE_SLOT_CATALOG_VERSION)
+	{
+		// Unknown index. It will be rebuilt on the next refresh
+		return;
+	}
+
+	TArray<FSESlotCatalogEntry> LoadedEntries;
+	Ar << LoadedEntries;
+	if (Ar.IsError())
+	{
+		return;
+	}
+	for (FSESlotCatalogEntry& Entry : LoadedEntries)
+	{
+		FString Name = Entry.Name;
+		Entries.Add(MoveTemp(Name), MoveTemp(Entry));
+	}
+}
+
+void FSESlotCatalog::SaveIndex() const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSESlotCatalog::SaveIndex);
+	FScopedFileWriter Writer(GetIndexPath());
+	if (!Writer.IsValid())
+	{
+		return;
+	}
+
+	FArchive& Ar = Writer.GetArchive();
+	int32 Tag = SE_SLOT_CATALOG_TAG;
+	int32 Version = SE_SLOT_CATALOG_VERSION;
+	Ar << Tag;
+	Ar << Version;
+
+	TArray<FSESlotCatalogEntry> SavedEntries;
+	Entries.GenerateValueArray(SavedEntries);
+	Ar << SavedEntries;
+}
+
+bool FSESlotCatalog::ReadEntry(FSESlotCatalogEntry& Entry)
+{
+	FScopedFileReader Reader(FSEFileHelpers::GetSlotPath(Entry.Name));
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	FSaveFile File{};
+	File.Read(Reader, true);
+	if (File.IsEmpty() || File.bCorrupted || File.ClassName.IsEmpty())
+	{
+		UE_LOG(LogSaveExtension, Warning, TEXT("Slot '%s' could not be indexed"), *Entry.Name);
+		return false;
+	}
+	FillEntry(Entry, File);
+	return true;
+}
+
+void FSESlotCatalog::FillEntry(FSESlotCatalogEntry& Entry, const FSaveFile& File)
+{
+	Entry.ClassName = File.ClassName;
+	Entry.InfoBytes = File.Bytes;
+	Entry.SaveDate = File.SaveDate.GetTicks() > 0 ? File.SaveDate : Entry.ModificationTime;
+	Entry.ThumbnailOffset = 0;
+	Entry.ThumbnailSize = 0;
+	for (const FSaveFileChunk& Chunk : File.Chunks)
+	{
+		if (Chunk.Type == ESaveFileChunkType::Thumbnail)
+		{
+			// Thumbnails in a journal are found through the table of contents
+			Entry.ThumbnailOffset = Chunk.SourceFile.IsEmpty() ? Chunk.Offset : 0;
+			Entry.ThumbnailSize = Chunk.Size;
+		}
+	}
+}
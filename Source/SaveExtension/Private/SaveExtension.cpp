@@ -2,11 +2,35 @@
 
 #include "SaveExtension.h"
 
+#include "SEFileHelpers.h"
+#include "SEPackFile.h"
+#include "SaveSettings.h"
+#include "Serialization/SEClassPlan.h"
+
+#include <HAL/FileManager.h>
+
 
 DEFINE_LOG_CATEGORY(LogSaveExtension)
 
 IMPLEMENT_MODULE(FSaveExtension, SaveExtension);
 
+void FSaveExtension::StartupModule()
+{
+	if (GetDefault<USaveSettings>()->bUsePackFile)
+	{
+		FSEPackPlatformFile::Mount();
+	}
+	FSEClassPlan::RegisterDelegates();
+}
+
+void FSaveExtension::ShutdownModule()
+{
+	FSEClassPlan::UnregisterDelegates();
+	FSEPackPlatformFile::Unmount();
+	// Spilled records are only valid for the process that wrote them
+	IFileManager::Get().DeleteDirectory(*FSEFileHelpers::GetSpillFolder(), false, true);
+}
+
 void FSaveExtension::Log(const USaveSlot* Slot, const FString& Message, FColor Color, bool bError, const float Duration)
 	{
 		if (Slot->bDebug)
@@ -3,6 +3,7 @@
 #include "SaveManager.h"
 
 #include "SEFileHelpers.h"
+#include "SESlotCatalog.h"
 #include "SaveExtension.h"
 #include "SaveSettings.h"
 #include "Serialization/SEDataTask_Load.h"
@@ -200,6 +201,11 @@ void USaveManager::Initialize(FSubsystemCollectionBase& Collection)
 	FCoreUObjectDelegates::PreLoadMap.AddUObject(this, &USaveManager::OnMapLoadStarted);
 	FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &USaveManager::OnMapLoadFinished);
 
+	// Warm up the catalog so that slot checks don't need to touch the disk
+	FSEFileHelpers::GetPipe().Launch(UE_SOURCE_LOCATION, []() {
+		FSESlotCatalog::Get().Refresh();
+	});
+
 	AssureActiveSlot();
 	if (ActiveSlot && ActiveSlot->bLoadOnStart)
 	{
@@ -308,38 +314,22 @@ void USaveManager::PreloadAllSlots(FSEOnAllSlotsPreloaded Callback, bool bSortBy
 
 void USaveManager::PreloadAllSlotsSync(TArray<USaveSlot*>& Slots, bool bSortByRecent)
 {
-	TArray<FString> FileNames;
-	FSEFileHelpers::FindAllFilesSync(FileNames);
+	// Only files that changed since they were cataloged are opened. Entries are sorted by the save date
+	// they store, so no slot needs to be deserialized to be sorted
+	TArray<FSESlotCatalogEntry> Entries;
+	FSESlotCatalog::Get().GetEntries(Entries, bSortByRecent);
 
-	TArray<FSaveFile> LoadedFiles;
-	LoadedFiles.Reserve(FileNames.Num());
-	for (const FString& FileName : FileNames)
+	Slots.Reserve(Slots.Num() + Entries.Num());
+	for (const auto& Entry : Entries)
 	{
-		// Load all files
-		FScopedFileReader Reader(FSEFileHelpers::GetSlotPath(FileName));
-		if (Reader.IsValid())
-		{
-			LoadedFiles.AddDefaulted_GetRef().Read(Reader, true);
-		}
-	}
-
-	Slots.Reserve(Slots.Num() + LoadedFiles.Num());
-	for (const auto& File : LoadedFiles)
-	{
-		auto* Slot =
-			Cast<USaveSlot>(FSEFileHelpers::DeserializeObject(nullptr, File.ClassName, this, File.Bytes));
+		auto* Slot = Cast<USaveSlot>(
+			FSEFileHelpers::DeserializeObject(nullptr, Entry.ClassName, this, Entry.InfoBytes));
 		if (Slot)
 		{
+			Slot->MarkThumbnailInFile(Entry.ThumbnailSize > 0);
 			Slots.Add(Slot);
 		}
 	}
-
-	if (bSortByRecent)
-	{
-		Slots.Sort([](const USaveSlot& A, const USaveSlot& B) {
-			return A.Stats.SaveDate > B.Stats.SaveDate;
-		});
-	}
 }
 
 bool USaveManager::DeleteSlotByNameSync(FName SlotName)
@@ -363,8 +353,9 @@ int32 USaveManager::DeleteAllSlotsSync()
 	int32 Count = 0;
 	for (const FString& SlotName : FoundSlots)
 	{
-		Count += FSEFileHelpers::DeleteFile(SlotName);
+		Count += FSEFileHelpers::DeleteFile(SlotName, false);
 	}
+	FSEFileHelpers::CollectBlobs();
 	return Count;
 }
 
@@ -4,12 +4,15 @@
 
 #include "SEFileHelpers.h"
 
+#include <Containers/Ticker.h>
 #include <Engine/Engine.h>
 #include <Engine/GameViewportClient.h>
 #include <Engine/Texture2D.h>
 #include <HighResScreenshot.h>
 #include <ImageUtils.h>
 #include <Misc/FileHelper.h>
+#include <Tasks/Pipe.h>
+#include <Tasks/Task.h>
 #include <TextureResource.h>
 #include <UnrealClient.h>
 
@@ -23,32 +26,91 @@ void USaveSlot::Serialize(FArchive& Ar)
 {
 	Super::Serialize(Ar);
 
-	bool bHasThumbnail = IsValid(Thumbnail);
+	// Thumbnails are saved in their own file section now
+	bool bHasThumbnail = false;
 	Ar << bHasThumbnail;
-	if (bHasThumbnail)
+	if (bHasThumbnail && Ar.IsLoading())
 	{
+		// Old slot with its thumbnail inline. Keep it encoded until requested
 		TArray64<uint8> ThumbnailData;
-		if (Ar.IsLoading())
-		{
-			Ar << ThumbnailData;
-			Thumbnail = FImageUtils::ImportBufferAsTexture2D(ThumbnailData);
-		}
-		else
-		{
-			uint8* MipData =
-				static_cast<uint8*>(Thumbnail->GetPlatformData()->Mips[0].BulkData.Lock(LOCK_READ_ONLY));
-			check(MipData != nullptr);
-			int64 MipDataSize = Thumbnail->GetPlatformData()->Mips[0].BulkData.GetBulkDataSize();
-
-			FImageView MipImage(MipData, Thumbnail->GetPlatformData()->SizeX,
-				Thumbnail->GetPlatformData()->SizeY, 1, ERawImageFormat::BGRA8, EGammaSpace::sRGB);
-			FImageUtils::CompressImage(ThumbnailData, TEXT("PNG"), MipImage);
-			Thumbnail->GetPlatformData()->Mips[0].BulkData.Unlock();
-			Ar << ThumbnailData;
-		}
+		Ar << ThumbnailData;
+		LegacyThumbnailBytes = TArray<uint8>(ThumbnailData);
 	}
 }
 
+void USaveSlot::LoadThumbnail(FSEOnThumbnailLoaded Callback)
+{
+	if (IsValid(Thumbnail) || !HasThumbnail())
+	{
+		Callback.ExecuteIfBound(Thumbnail);
+		return;
+	}
+
+	TWeakObjectPtr<USaveSlot> WeakThis{this};
+	FSEFileHelpers::GetPipe().Launch(UE_SOURCE_LOCATION,
+		[WeakThis, SlotName = Name.ToString(), Bytes = LegacyThumbnailBytes, Callback]() mutable {
+			if (Bytes.IsEmpty())
+			{
+				FSEFileHelpers::LoadThumbnailSync(SlotName, Bytes);
+			}
+
+			// Decode out of the file pipe
+			UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakThis, Bytes = MoveTemp(Bytes), Callback]() {
+				TRACE_CPUPROFILER_EVENT_SCOPE(USaveSlot::DecodeThumbnail);
+				auto Image = MakeShared<FImage>();
+				const bool bDecoded =
+					!Bytes.IsEmpty() && FImageUtils::DecompressImage(Bytes.GetData(), Bytes.Num(), *Image);
+
+				// Textures can only be created in the game thread
+				FTSTicker::GetCoreTicker().AddTicker(
+					FTickerDelegate::CreateLambda([WeakThis, Image, bDecoded, Callback](float) {
+						USaveSlot* Slot = WeakThis.Get();
+						if (Slot && bDecoded && !IsValid(Slot->Thumbnail))
+						{
+							Slot->Thumbnail = FImageUtils::CreateTexture2DFromImage(*Image);
+						}
+						Callback.ExecuteIfBound(Slot ? Slot->Thumbnail.Get() : nullptr);
+						return false;
+					}));
+			});
+		});
+}
+
+bool USaveSlot::HasThumbnail() const
+{
+	return IsValid(Thumbnail) || bThumbnailInFile || !LegacyThumbnailBytes.IsEmpty();
+}
+
+bool USaveSlot::EncodeThumbnail(TArray<uint8>& OutBytes) const
+{
+	if (!IsValid(Thumbnail))
+	{
+		OutBytes = LegacyThumbnailBytes;
+		return !OutBytes.IsEmpty();
+	}
+
+	FTexturePlatformData* PlatformData = Thumbnail->GetPlatformData();
+	if (!PlatformData || PlatformData->Mips.IsEmpty())
+	{
+		return false;
+	}
+
+	const uint8* MipData = static_cast<const uint8*>(PlatformData->Mips[0].BulkData.LockReadOnly());
+	if (!MipData)
+	{
+		return false;
+	}
+
+	TArray64<uint8> ThumbnailData;
+	FImageView MipImage(const_cast<uint8*>(MipData), PlatformData->SizeX, PlatformData->SizeY, 1,
+		ERawImageFormat::BGRA8, EGammaSpace::sRGB);
+	FImageUtils::CompressImage(ThumbnailData, TEXT("PNG"), MipImage);
+	PlatformData->Mips[0].BulkData.Unlock();
+
+	OutBytes = TArray<uint8>(ThumbnailData);
+	return !OutBytes.IsEmpty();
+}
+
 void USaveSlot::CaptureThumbnail(
 	FSEOnThumbnailCaptured Callback, const int32 Width /*= 640*/, const int32 Height /*= 360*/)
 {
@@ -18,6 +18,38 @@ void USaveSlotData::Serialize(FArchive& Ar)
 	Ar << SubLevels;
 }
 
+void USaveSlotData::SerializeProperties(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+	Ar << TimeSeconds;
+}
+
+FLevelRecord* USaveSlotData::FindLevelRecord(FName LevelName)
+{
+	if (LevelName == FPersistentLevelRecord::PersistentName)
+	{
+		return &RootLevel;
+	}
+	return SubLevels.FindByPredicate([LevelName](const FStreamingLevelRecord& Record) {
+		return Record.Name == LevelName;
+	});
+}
+
+void USaveSlotData::DetachMappedRecords()
+{
+	auto DetachLevel = [](FLevelRecord& Level) {
+		if (Level.Buffer && Level.Buffer->MappedRegion)
+		{
+			Level.DetachBuffer();
+		}
+	};
+	DetachLevel(RootLevel);
+	for (FStreamingLevelRecord& Level : SubLevels)
+	{
+		DetachLevel(Level);
+	}
+}
+
 void USaveSlotData::CleanRecords(bool bKeepSublevels)
 {
 	// Clean Up serialization data
@@ -3,6 +3,11 @@
 #include "Serialization/LevelRecords.h"
 
 #include "SaveSlotData.h"
+#include "Serialization/SETransformColumn.h"
+
+#include <Algo/StableSort.h>
+#include <Serialization/MemoryReader.h>
+#include <Serialization/MemoryWriter.h>
 
 
 /////////////////////////////////////////////////////
@@ -11,6 +16,336 @@
 const FName FPersistentLevelRecord::PersistentName{"Persistent"};
 
 
+/** Archives of each field stream of records grouped by class. When saving, only the stream being written is
+ * set and the fields of the others are skipped
+ */
+struct FSERecordStreams
+{
+	FArchive* Headers = nullptr;
+	FArchive* Transforms = nullptr;
+	FArchive* Tags = nullptr;
+	FArchive* Data = nullptr;
+	/** If set, transforms and velocities are stored in it instead of the transforms stream */
+	FSETransformColumn* Column = nullptr;
+	int32 NextTransform = 0;
+	int32 NextVelocity = 0;
+};
+
+/** Counts the bytes saved into it, so that the size of a stream is known before the stream is written */
+class FSEStreamCounter : public FArchive
+{
+	int64 Size = 0;
+
+public:
+	FSEStreamCounter()
+	{
+		SetIsSaving(true);
+	}
+
+	virtual void Serialize(void* Data, int64 Num) override
+	{
+		Size += Num;
+	}
+	virtual int64 Tell() override
+	{
+		return Size;
+	}
+	virtual int64 TotalSize() override
+	{
+		return Size;
+	}
+};
+
+static void SerializeGroupedObject(FSERecordStreams& Streams, FObjectRecord& Record)
+{
+	if (Streams.Headers)
+	{
+		*Streams.Headers << Record.Name;
+		*Streams.Headers << Record.Class;
+	}
+	if (Streams.Tags)
+	{
+		*Streams.Tags << Record.Tags;
+	}
+	if (Streams.Data)
+	{
+		Record.SerializeData(*Streams.Data);
+	}
+}
+
+static void SerializeGroupedTransform(FSERecordStreams& Streams, FTransform& Transform)
+{
+	if (!Streams.Transforms)
+	{
+		return;
+	}
+	if (!Streams.Column)
+	{
+		*Streams.Transforms << Transform;
+	}
+	else if (Streams.Transforms->IsSaving())
+	{
+		Streams.Column->Transforms.Add(Transform);
+	}
+	else if (Streams.Column->Transforms.IsValidIndex(Streams.NextTransform))
+	{
+		Transform = Streams.Column->Transforms[Streams.NextTransform++];
+	}
+	else
+	{
+		Streams.Transforms->SetError();
+	}
+}
+
+static void SerializeGroupedVelocity(FSERecordStreams& Streams, FActorRecord& Record)
+{
+	if (!Streams.Transforms)
+	{
+		return;
+	}
+	if (!Streams.Column)
+	{
+		bool bIsMoving = Streams.Transforms->IsSaving() &&
+						 (!Record.LinearVelocity.IsNearlyZero() || !Record.AngularVelocity.IsNearlyZero());
+		*Streams.Transforms << bIsMoving;
+		if (bIsMoving)
+		{
+			*Streams.Transforms << Record.LinearVelocity;
+			*Streams.Transforms << Record.AngularVelocity;
+		}
+	}
+	else if (Streams.Transforms->IsSaving())
+	{
+		Streams.Column->LinearVelocities.Add(Record.LinearVelocity);
+		Streams.Column->AngularVelocities.Add(Record.AngularVelocity);
+	}
+	else if (Streams.Column->LinearVelocities.IsValidIndex(Streams.NextVelocity))
+	{
+		Record.LinearVelocity = Streams.Column->LinearVelocities[Streams.NextVelocity];
+		Record.AngularVelocity = Streams.Column->AngularVelocities[Streams.NextVelocity];
+		++Streams.NextVelocity;
+	}
+	else
+	{
+		Streams.Transforms->SetError();
+	}
+}
+
+static void SerializeGroupedActor(FSERecordStreams& Streams, FActorRecord& Record)
+{
+	SerializeGroupedObject(Streams, Record);
+	if (Streams.Headers)
+	{
+		Streams.Headers->SerializeBits(&Record.bHiddenInGame, 1);
+		Streams.Headers->SerializeBits(&Record.bIsProcedural, 1);
+	}
+
+	SerializeGroupedTransform(Streams, Record.Transform);
+	SerializeGroupedVelocity(Streams, Record);
+
+	if (Streams.Headers)
+	{
+		int32 NumComponents = Record.ComponentRecords.Num();
+		*Streams.Headers << NumComponents;
+		if (Streams.Headers->IsLoading())
+		{
+			// Each component has at least one byte of header
+			if (NumComponents < 0 || NumComponents > Streams.Headers->TotalSize())
+			{
+				Streams.Headers->SetError();
+				return;
+			}
+			Record.ComponentRecords.SetNum(NumComponents);
+		}
+	}
+	for (FComponentRecord& Component : Record.ComponentRecords)
+	{
+		SerializeGroupedObject(Streams, Component);
+		SerializeGroupedTransform(Streams, Component.Transform);
+	}
+}
+
+/** Serializes the size of a field stream. Older files store it in 32 bits */
+static void SerializeStreamSize(FArchive& Ar, int64& Num, bool bLarge)
+{
+	if (bLarge)
+	{
+		Ar << Num;
+		return;
+	}
+	if (Num > MAX_int32)
+	{
+		Ar.SetError();
+		return;
+	}
+	int32 SmallNum = int32(Num);
+	Ar << SmallNum;
+	Num = SmallNum;
+}
+
+/** Loads the bytes of a field stream. When loading from the buffer of a level, the stream is read as a view
+ * into it instead of copied
+ */
+static void LoadStream(FArchive& Ar, TArray64<uint8>& Bytes, TConstArrayView64<uint8>& OutView, bool bLarge)
+{
+	int64 Num = 0;
+	SerializeStreamSize(Ar, Num, bLarge);
+
+	const int64 Offset = Ar.Tell();
+	if (Ar.IsError() || Num < 0 || Offset + Num > Ar.TotalSize())
+	{
+		Ar.SetError();
+		return;
+	}
+	const SERecords::FDataViewScope* ViewScope = SERecords::FDataViewScope::Get();
+	if (ViewScope && Offset + Num <= ViewScope->Buffer.Num())
+	{
+		OutView = ViewScope->Buffer.Slice(Offset, Num);
+		Ar.Seek(Offset + Num);
+		return;
+	}
+	Bytes.SetNumUninitialized(Num);
+	Ar.Serialize(Bytes.GetData(), Num);
+	OutView = Bytes;
+}
+
+/** Serializes actors grouped by class, and the permutation that restores their order when loaded */
+static bool SerializeGroupedActors(FArchive& Ar, FLevelRecord& Level)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(SerializeGroupedActors);
+
+	// Position of each actor in the streams
+	TArray<int32> Order;
+	if (Ar.IsSaving())
+	{
+		TArray<int32> ClassIndices;
+		ClassIndices.SetNumUninitialized(Level.Actors.Num());
+		Order.SetNumUninitialized(Level.Actors.Num());
+		for (int32 i = 0; i < Level.Actors.Num(); ++i)
+		{
+			Order[i] = i;
+			// Already in the table. Its index keeps the layout the same between saves
+			ClassIndices[i] = Level.Objects.Add(Level.Actors[i].Class);
+		}
+		Algo::StableSort(Order, [&ClassIndices](int32 A, int32 B) {
+			return ClassIndices[A] < ClassIndices[B];
+		});
+	}
+	Ar << Order;
+	if (Ar.IsLoading())
+	{
+		TBitArray<> Found{false, Order.Num()};
+		for (int32 Index : Order)
+		{
+			if (!Found.IsValidIndex(Index) || Found[Index])
+			{
+				Ar.SetError();
+				return false;
+			}
+			Found[Index] = true;
+		}
+		Level.Actors.Reset(Order.Num());
+		Level.Actors.SetNum(Order.Num());
+	}
+
+	TOptional<FSETransformColumn> Column;
+	if (Level.Tables >= ESELevelTables::TransformColumns)
+	{
+		Column.Emplace(Level.TransformPositionBits, Level.TransformRotationBits);
+	}
+
+	const FSEArchiveTables Tables = Level.GetTables();
+	const bool bLargeStreams = Level.Tables >= ESELevelTables::LargeStreams;
+	constexpr int32 NumStreams = 4;
+	if (Ar.IsSaving())
+	{
+		// Each stream takes a pass over the records to count its size and another to write it straight into
+		// the chunk, so that streams are never buffered in memory
+		auto SerializeStreamOf = [&Level, &Order, &Column](FArchive& StreamAr, int32 StreamIndex) {
+			FSERecordStreams Streams;
+			Streams.Column = Column.GetPtrOrNull();
+			FArchive** Stream[NumStreams] = {
+				&Streams.Headers, &Streams.Transforms, &Streams.Tags, &Streams.Data};
+			*Stream[StreamIndex] = &StreamAr;
+			for (int32 Index : Order)
+			{
+				SerializeGroupedActor(Streams, Level.Actors[Index]);
+			}
+		};
+
+		if (Column)
+		{
+			// Transforms are stored in the column instead of their stream, which stays empty
+			FSEStreamCounter Counter;
+			FSEArchive CounterAr(Counter, true, Tables);
+			SerializeStreamOf(CounterAr, 1);
+			Column->Serialize(Ar);
+			Level.TransformPositionBits = Column->PositionBits;
+			Level.TransformRotationBits = Column->RotationBits;
+		}
+		for (int32 i = 0; i < NumStreams && !Ar.IsError(); ++i)
+		{
+			int64 Size = 0;
+			if (i != 1 || !Column)
+			{
+				FSEStreamCounter Counter;
+				FSEArchive CounterAr(Counter, true, Tables);
+				SerializeStreamOf(CounterAr, i);
+				Size = Counter.TotalSize();
+			}
+			SerializeStreamSize(Ar, Size, bLargeStreams);
+			if (Size > 0 && !Ar.IsError())
+			{
+				const int64 Start = Ar.Tell();
+				SerializeStreamOf(Ar, i);
+				if (Ar.Tell() - Start != Size)
+				{
+					Ar.SetError();
+				}
+			}
+		}
+		return !Ar.IsError();
+	}
+
+	if (Column)
+	{
+		Column->Serialize(Ar);
+		Level.TransformPositionBits = Column->PositionBits;
+		Level.TransformRotationBits = Column->RotationBits;
+	}
+	TArray64<uint8> StreamBytes[NumStreams];
+	TConstArrayView64<uint8> StreamViews[NumStreams];
+	for (int32 i = 0; i < NumStreams && !Ar.IsError(); ++i)
+	{
+		LoadStream(Ar, StreamBytes[i], StreamViews[i], bLargeStreams);
+	}
+	if (Ar.IsError())
+	{
+		return false;
+	}
+
+	FMemoryReaderView HeadersReader(MakeMemoryView(StreamViews[0]), true);
+	FMemoryReaderView TransformsReader(MakeMemoryView(StreamViews[1]), true);
+	FMemoryReaderView TagsReader(MakeMemoryView(StreamViews[2]), true);
+	FMemoryReaderView DataReader(MakeMemoryView(StreamViews[3]), true);
+	FSEArchive HeadersAr(HeadersReader, true, Tables);
+	FSEArchive TransformsAr(TransformsReader, true, Tables);
+	FSEArchive TagsAr(TagsReader, true, Tables);
+	FSEArchive DataAr(DataReader, true, Tables);
+	FSERecordStreams Streams{&HeadersAr, &TransformsAr, &TagsAr, &DataAr, Column.GetPtrOrNull()};
+	for (int32 Index : Order)
+	{
+		SerializeGroupedActor(Streams, Level.Actors[Index]);
+		if (HeadersAr.IsError() || TransformsAr.IsError() || TagsAr.IsError() || DataAr.IsError())
+		{
+			Ar.SetError();
+			return false;
+		}
+	}
+	return true;
+}
+
+
 bool FLevelRecord::Serialize(FArchive& Ar)
 {
 	Super::Serialize(Ar);
@@ -21,8 +356,142 @@ bool FLevelRecord::Serialize(FArchive& Ar)
 	return true;
 }
 
+bool FLevelRecord::SerializeWithTables(FArchive& Ar)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FLevelRecord::SerializeWithTables);
+	TArray<const FObjectRecord*> Records;
+	if (Ar.IsSaving())
+	{
+		// Names and objects inside record data were added while serializing actors. Add the ones of the records
+		auto AddRecordNames = [this, &Records](const FObjectRecord& Record) {
+			Records.Add(&Record);
+			Names.Add(Record.Name);
+			for (const FName& Tag : Record.Tags)
+			{
+				Names.Add(Tag);
+			}
+			if (Tables >= ESELevelTables::NamesAndObjects)
+			{
+				Objects.Add(Record.Class);
+			}
+		};
+		auto AddActorNames = [&AddRecordNames](const FActorRecord& Record) {
+			AddRecordNames(Record);
+			for (const FComponentRecord& Component : Record.ComponentRecords)
+			{
+				AddRecordNames(Component);
+			}
+		};
+
+		Names.Add(Name);
+		AddActorNames(LevelScript);
+		for (const FActorRecord& Actor : Actors)
+		{
+			AddActorNames(Actor);
+		}
+	}
+
+	Names.Serialize(Ar);
+	if (Tables >= ESELevelTables::NamesAndObjects)
+	{
+		Objects.Serialize(Ar, Tables >= ESELevelTables::RecordRefs);
+	}
+
+	TOptional<SERecords::FDataTableScope> DataTable;
+	if (Tables >= ESELevelTables::Payloads)
+	{
+		DataTable.Emplace();
+		if (Ar.IsSaving())
+		{
+			DataTable->Add(Records);
+		}
+		DataTable->Serialize(Ar);
+	}
+
+	FSEArchive RecordsAr(Ar, true, GetTables());
+	if (Tables >= ESELevelTables::ClassPlans)
+	{
+		RecordsAr << bUseClassPlans;
+	}
+	else if (Ar.IsLoading())
+	{
+		bUseClassPlans = false;
+	}
+	if (Tables >= ESELevelTables::RecordLayouts)
+	{
+		RecordsAr << bGroupByClass;
+		if (bGroupByClass)
+		{
+			FBaseRecord::Serialize(RecordsAr);
+			RecordsAr << LevelScript;
+			return SerializeGroupedActors(RecordsAr, *this) && !RecordsAr.IsError();
+		}
+	}
+	return Serialize(RecordsAr) && !RecordsAr.IsError();
+}
+
 void FLevelRecord::CleanRecords()
 {
 	LevelScript = {};
 	Actors.Empty();
+	RecordsToActors.Empty();
+	PendingFile.Empty();
+	Buffer.Reset();
+	Names.Reset();
+	Objects.Reset();
+	Tables = ESELevelTables::Latest;
+}
+
+SIZE_T FLevelRecord::GetAllocatedSize() const
+{
+	auto GetRecordSize = [](const FObjectRecord& Record) {
+		return Record.Data.GetAllocatedSize() + Record.Tags.GetAllocatedSize();
+	};
+
+	// Tables are small next to the records
+	SIZE_T Size = Actors.GetAllocatedSize() + GetRecordSize(LevelScript);
+	for (const FActorRecord& Record : Actors)
+	{
+		Size += GetRecordSize(Record) + Record.ComponentRecords.GetAllocatedSize();
+		for (const FComponentRecord& ComponentRecord : Record.ComponentRecords)
+		{
+			Size += GetRecordSize(ComponentRecord);
+		}
+	}
+	if (Buffer)
+	{
+		// Mapped regions are paged in by the OS, but count them anyway
+		Size += Buffer->GetView().Num();
+	}
+	return Size;
+}
+
+void FLevelRecord::DetachBuffer()
+{
+	if (!Buffer)
+	{
+		return;
+	}
+
+	auto Detach = [](FObjectRecord& Record) {
+		if (Record.Data.IsEmpty() && !Record.DataView.IsEmpty())
+		{
+			Record.Data = TArray<uint8>{Record.DataView};
+		}
+		Record.DataView = {};
+	};
+	auto DetachActor = [&Detach](FActorRecord& Record) {
+		Detach(Record);
+		for (FComponentRecord& ComponentRecord : Record.ComponentRecords)
+		{
+			Detach(ComponentRecord);
+		}
+	};
+
+	DetachActor(LevelScript);
+	for (FActorRecord& Actor : Actors)
+	{
+		DetachActor(Actor);
+	}
+	Buffer.Reset();
 }
@@ -6,11 +6,16 @@
 #include "SaveExtension.h"
 #include "SaveSlotData.h"
 #include "Serialization/SEArchive.h"
+#include "Serialization/SEClassPlan.h"
 
+#include <Async/ParallelFor.h>
 #include <Components/PrimitiveComponent.h>
 #include <GameFramework/Pawn.h>
 #include <GameFramework/PlayerController.h>
 #include <GameFramework/PlayerState.h>
+#include <Hash/xxhash.h>
+#include <Serialization/MemoryReader.h>
+#include <Serialization/MemoryWriter.h>
 
 
 /////////////////////////////////////////////////////
@@ -43,12 +48,72 @@ bool FObjectRecord::Serialize(FArchive& Ar)
 
 	if (Class)
 	{
-		Ar << Data;
+		SerializeData(Ar);
 		Ar << Tags;
 	}
 	return true;
 }
 
+void FObjectRecord::SerializeData(FArchive& Ar)
+{
+	const SERecords::FDataViewScope* ViewScope = Ar.IsLoading() ? SERecords::FDataViewScope::Get() : nullptr;
+	if (const SERecords::FDataTableScope* TableScope = SERecords::FDataTableScope::Get())
+	{
+		// Data is stored once in the table of the level
+		int32 Index = Ar.IsSaving() ? TableScope->Find(GetData()) : INDEX_NONE;
+		Ar << Index;
+		if (Ar.IsLoading())
+		{
+			Data.Empty();
+			DataView = {};
+			if (Index != INDEX_NONE)
+			{
+				if (!TableScope->Payloads.IsValidIndex(Index))
+				{
+					Ar.SetError();
+					return;
+				}
+				if (ViewScope)
+				{
+					DataView = TableScope->Payloads[Index];
+				}
+				else
+				{
+					Data = TArray<uint8>{TableScope->Payloads[Index]};
+				}
+			}
+		}
+	}
+	else if (ViewScope)
+	{
+		// Point into the buffer being read instead of copying
+		int32 Num = 0;
+		Ar << Num;
+		const int64 Offset = Ar.Tell();
+		if (Num < 0 || Offset < 0 || Offset + Num > ViewScope->Buffer.Num())
+		{
+			Ar.SetError();
+			return;
+		}
+		Data.Empty();
+		DataView = {ViewScope->Buffer.GetData() + Offset, Num};
+		Ar.Seek(Offset + Num);
+	}
+	else if (Ar.IsSaving() && Data.IsEmpty())
+	{
+		// Records still pointing at the file they were loaded from
+		TConstArrayView<uint8> View = DataView;
+		int32 Num = View.Num();
+		Ar << Num;
+		Ar.Serialize(const_cast<uint8*>(View.GetData()), Num);
+	}
+	else
+	{
+		Ar << Data;
+		DataView = {};
+	}
+}
+
 bool FComponentRecord::Serialize(FArchive& Ar)
 {
 	Super::Serialize(Ar);
@@ -98,9 +163,168 @@ const FName SERecords::TagNoTransform{"!SaveTransform"};
 const FName SERecords::TagNoPhysics{"!SavePhysics"};
 const FName SERecords::TagNoTags{"!SaveTags"};
 
+static thread_local const SERecords::FDataViewScope* CurrentDataViewScope = nullptr;
+static thread_local const SERecords::FDataTableScope* CurrentDataTableScope = nullptr;
+
+
+SERecords::FDataViewScope::FDataViewScope(TConstArrayView64<uint8> InBuffer)
+	: Buffer(InBuffer)
+	, Previous(CurrentDataViewScope)
+{
+	CurrentDataViewScope = this;
+}
+
+SERecords::FDataViewScope::~FDataViewScope()
+{
+	CurrentDataViewScope = Previous;
+}
+
+const SERecords::FDataViewScope* SERecords::FDataViewScope::Get()
+{
+	return CurrentDataViewScope;
+}
+
+
+SERecords::FDataTableScope::FDataTableScope() : Previous(CurrentDataTableScope)
+{
+	CurrentDataTableScope = this;
+}
+
+SERecords::FDataTableScope::~FDataTableScope()
+{
+	CurrentDataTableScope = Previous;
+}
+
+void SERecords::FDataTableScope::Add(TConstArrayView<const FObjectRecord*> Records)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(SERecords::FDataTableScope::Add);
+
+	TArray<uint64> Hashes;
+	Hashes.SetNumUninitialized(Records.Num());
+	ParallelFor(Records.Num(), [&Records, &Hashes](int32 i) {
+		const TConstArrayView<uint8> Data = Records[i]->GetData();
+		Hashes[i] = FXxHash64::HashBuffer(Data.GetData(), Data.Num()).Hash;
+	});
+
+	TMap<uint64, int32> IndicesByHash;
+	IndicesByHash.Reserve(Records.Num());
+	for (int32 i = 0; i < Records.Num(); ++i)
+	{
+		const TConstArrayView<uint8> Data = Records[i]->GetData();
+		if (Data.IsEmpty() || Indices.Contains(Data.GetData()))
+		{
+			continue;
+		}
+
+		int32 Index = INDEX_NONE;
+		if (const int32* HashIndex = IndicesByHash.Find(Hashes[i]))
+		{
+			// Compare the bytes in case of a hash collision
+			const TConstArrayView<uint8> Payload = Payloads[*HashIndex];
+			if (Payload.Num() == Data.Num() && FMemory::Memcmp(Payload.GetData(), Data.GetData(), Data.Num()) == 0)
+			{
+				Index = *HashIndex;
+			}
+		}
+		if (Index == INDEX_NONE)
+		{
+			Index = Payloads.Add(Data);
+			IndicesByHash.FindOrAdd(Hashes[i], Index);
+		}
+		Indices.Add(Data.GetData(), Index);
+	}
+}
+
+int32 SERecords::FDataTableScope::Find(TConstArrayView<uint8> Data) const
+{
+	const int32* Index = Data.IsEmpty() ? nullptr : Indices.Find(Data.GetData());
+	return Index ? *Index : INDEX_NONE;
+}
+
+void SERecords::FDataTableScope::Serialize(FArchive& Ar)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(SERecords::FDataTableScope::Serialize);
+
+	int32 Num = Payloads.Num();
+	Ar << Num;
+	if (Ar.IsLoading())
+	{
+		if (Num < 0)
+		{
+			Ar.SetError();
+			return;
+		}
+		Payloads.Reset(Num);
+		Copies.Reset();
+		Indices.Reset();
+
+		const FDataViewScope* ViewScope = FDataViewScope::Get();
+		for (int32 i = 0; i < Num && !Ar.IsError(); ++i)
+		{
+			if (!ViewScope)
+			{
+				Ar << Copies.AddDefaulted_GetRef();
+				continue;
+			}
+
+			// Point into the buffer being read instead of copying
+			int32 Size = 0;
+			Ar << Size;
+			const int64 Offset = Ar.Tell();
+			if (Size < 0 || Offset < 0 || Offset + Size > ViewScope->Buffer.Num())
+			{
+				Ar.SetError();
+				return;
+			}
+			Payloads.Emplace(ViewScope->Buffer.GetData() + Offset, Size);
+			Ar.Seek(Offset + Size);
+		}
+		for (const TArray<uint8>& Copy : Copies)
+		{
+			Payloads.Add(Copy);
+		}
+	}
+	else
+	{
+		for (const TConstArrayView<uint8>& Payload : Payloads)
+		{
+			int32 Size = Payload.Num();
+			Ar << Size;
+			Ar.Serialize(const_cast<uint8*>(Payload.GetData()), Size);
+		}
+	}
+}
+
+const SERecords::FDataTableScope* SERecords::FDataTableScope::Get()
+{
+	return CurrentDataTableScope;
+}
+
+
+/** Saves or loads the data of an object with the plan of its class, or everything its Serialize stores */
+static void SerializeObjectData(
+	FArchive& DataAr, UObject* Object, const FSEClassPlan& Plan, FSEArchiveTables Tables)
+{
+	if (Tables.bClassPlans && (Plan.Entries.IsEmpty() || (DataAr.IsLoading() && DataAr.TotalSize() == 0)))
+	{
+		// Nothing to store
+		return;
+	}
+
+	FSEArchive Archive(DataAr, false, Tables);
+	if (Tables.bClassPlans)
+	{
+		Plan.Serialize(Archive, Object);
+	}
+	else
+	{
+		Object->Serialize(Archive);
+	}
+}
+
 
 void SERecords::SerializeActor(
-	const AActor* Actor, FActorRecord& Record, const FSEClassFilter& ComponentFilter)
+	const AActor* Actor, FActorRecord& Record, const FSEClassFilter& ComponentFilter, FSEArchiveTables Tables)
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(SerializeActor);
 
@@ -166,26 +390,29 @@ void SERecords::SerializeActor(
 					ComponentRecord.Tags = Component->ComponentTags;
 				}
 
-				if (Component->GetClass()->IsChildOf<UPrimitiveComponent>())
+				const TSharedRef<const FSEClassPlan, ESPMode::ThreadSafe> Plan =
+					FSEClassPlan::Get(Component->GetClass());
+				if (!Plan->bStoresData)
 				{
 					continue;
 				}
 
 				FMemoryWriter MemoryWriter(ComponentRecord.Data, true);
-				FSEArchive Archive(MemoryWriter, false);
-				Component->Serialize(Archive);
+				Tables.FixupComponent = Record.ComponentRecords.Num() - 1;
+				SerializeObjectData(MemoryWriter, Component, *Plan, Tables);
 			}
 		}
 	}
 
 	TRACE_CPUPROFILER_EVENT_SCOPE(SerializeActor | Serialize);
 	FMemoryWriter MemoryWriter(Record.Data, true);
-	FSEArchive Archive(MemoryWriter, false);
-	const_cast<AActor*>(Actor)->Serialize(Archive);
+	Tables.FixupComponent = INDEX_NONE;
+	SerializeObjectData(
+		MemoryWriter, const_cast<AActor*>(Actor), *FSEClassPlan::Get(Actor->GetClass()), Tables);
 }
 
 bool SERecords::DeserializeActor(
-	AActor* Actor, const FActorRecord& Record, const FSEClassFilter& ComponentFilter)
+	AActor* Actor, const FActorRecord& Record, const FSEClassFilter& ComponentFilter, FSEArchiveTables Tables)
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(DeserializeActor);
 
@@ -246,22 +473,78 @@ bool SERecords::DeserializeActor(
 
 			Component->ComponentTags = ComponentRecord->Tags;
 
-			if (!Component->GetClass()->IsChildOf<UPrimitiveComponent>())
+			const TSharedRef<const FSEClassPlan, ESPMode::ThreadSafe> Plan =
+				FSEClassPlan::Get(Component->GetClass());
+			if (Plan->bStoresData)
 			{
-				FMemoryReader MemoryReader(ComponentRecord->Data, true);
-				FSEArchive Archive(MemoryReader, false);
-				Component->Serialize(Archive);
+				FMemoryReaderView MemoryReader(ComponentRecord->GetData(), true);
+				SerializeObjectData(MemoryReader, Component, *Plan, Tables);
 			}
 		}
 	}
 
 	TRACE_CPUPROFILER_EVENT_SCOPE(DeserializeActor | Deserialize);
-	FMemoryReader MemoryReader(Record.Data, true);
-	FSEArchive Archive(MemoryReader, false);
-	Actor->Serialize(Archive);
+	FMemoryReaderView MemoryReader(Record.GetData(), true);
+	SerializeObjectData(MemoryReader, Actor, *FSEClassPlan::Get(Actor->GetClass()), Tables);
 	return true;
 }
 
+void SERecords::SortTables(
+	FSEArchiveTables Tables, TArrayView<FActorRecord> Records, TConstArrayView<TArray<FSETableFixup>> Fixups)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(SERecords::SortTables);
+	check(Records.Num() == Fixups.Num());
+	if (!Tables.Names)
+	{
+		return;
+	}
+
+	TArray<int32> NameIndices;
+	TArray<int32> ObjectIndices;
+	NameIndices.Init(INDEX_NONE, Tables.Names->Num());
+	ObjectIndices.Init(INDEX_NONE, Tables.Objects ? Tables.Objects->Num() : 0);
+	int32 NumNames = 0;
+	int32 NumObjects = 0;
+	for (const TArray<FSETableFixup>& RecordFixups : Fixups)
+	{
+		for (const FSETableFixup& Fixup : RecordFixups)
+		{
+			int32& NewIndex = Fixup.bObject ? ObjectIndices[Fixup.Index] : NameIndices[Fixup.Index];
+			if (NewIndex == INDEX_NONE)
+			{
+				NewIndex = Fixup.bObject ? NumObjects++ : NumNames++;
+			}
+		}
+	}
+	// Entries no record data uses go last, in the order they were added
+	for (int32& NewIndex : NameIndices)
+	{
+		NewIndex = NewIndex != INDEX_NONE ? NewIndex : NumNames++;
+	}
+	for (int32& NewIndex : ObjectIndices)
+	{
+		NewIndex = NewIndex != INDEX_NONE ? NewIndex : NumObjects++;
+	}
+
+	Tables.Names->Remap(NameIndices);
+	if (Tables.Objects)
+	{
+		Tables.Objects->Remap(ObjectIndices);
+	}
+
+	for (int32 i = 0; i < Records.Num(); ++i)
+	{
+		FActorRecord& Record = Records[i];
+		for (const FSETableFixup& Fixup : Fixups[i])
+		{
+			TArray<uint8>& Data =
+				Fixup.Component == INDEX_NONE ? Record.Data : Record.ComponentRecords[Fixup.Component].Data;
+			const int32 NewIndex = Fixup.bObject ? ObjectIndices[Fixup.Index] : NameIndices[Fixup.Index];
+			FMemory::Memcpy(Data.GetData() + Fixup.Offset, &NewIndex, sizeof(int32));
+		}
+	}
+}
+
 void SERecords::SerializePlayer(
 	const APlayerState* PlayerState, FPlayerRecord& Record, const FSEClassFilter& ComponentFilter)
 {
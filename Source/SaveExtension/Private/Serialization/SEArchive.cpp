@@ -6,11 +6,345 @@
 
 
 
+/////////////////////////////////////////////////////
+// FSENameTable
+
+FSENameTable::FSENameTable(const FSENameTable& Other)
+{
+	*this = Other;
+}
+
+FSENameTable& FSENameTable::operator=(const FSENameTable& Other)
+{
+	if (this != &Other)
+	{
+		FReadScopeLock OtherLock(Other.Lock);
+		FWriteScopeLock ScopeLock(Lock);
+		Names = Other.Names;
+		Indices = Other.Indices;
+	}
+	return *this;
+}
+
+int32 FSENameTable::Add(FName Name)
+{
+	{
+		FReadScopeLock ScopeLock(Lock);
+		if (const int32* Index = Indices.Find(Name))
+		{
+			return *Index;
+		}
+	}
+
+	FWriteScopeLock ScopeLock(Lock);
+	// Another thread could have added it while unlocked
+	if (const int32* Index = Indices.Find(Name))
+	{
+		return *Index;
+	}
+	const int32 Index = Names.Add(Name);
+	Indices.Add(Name, Index);
+	return Index;
+}
+
+void FSENameTable::Reset()
+{
+	FWriteScopeLock ScopeLock(Lock);
+	Names.Reset();
+	Indices.Reset();
+}
+
+void FSENameTable::Remap(TConstArrayView<int32> NewIndices)
+{
+	FWriteScopeLock ScopeLock(Lock);
+	check(NewIndices.Num() == Names.Num());
+	TArray<FName> NewNames;
+	NewNames.SetNum(Names.Num());
+	for (int32 Index = 0; Index < Names.Num(); ++Index)
+	{
+		NewNames[NewIndices[Index]] = Names[Index];
+	}
+	Names = MoveTemp(NewNames);
+	for (auto& Entry : Indices)
+	{
+		Entry.Value = NewIndices[Entry.Value];
+	}
+}
+
+void FSENameTable::Serialize(FArchive& Ar)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSENameTable::Serialize);
+	FWriteScopeLock ScopeLock(Lock);
+
+	int32 Num = Names.Num();
+	Ar << Num;
+	if (Ar.IsLoading())
+	{
+		if (Num < 0)
+		{
+			Ar.SetError();
+			return;
+		}
+		Names.Reset(Num);
+		Indices.Reset();
+		Indices.Reserve(Num);
+		FString NameString;
+		for (int32 i = 0; i < Num && !Ar.IsError(); ++i)
+		{
+			Ar << NameString;
+			const FName Name{NameString};
+			// Case variations of a name resolve to the same entry. Keep the index of the first one
+			Indices.FindOrAdd(Name, Names.Add(Name));
+		}
+	}
+	else
+	{
+		FString NameString;
+		for (const FName& Name : Names)
+		{
+			Name.ToString(NameString);
+			Ar << NameString;
+		}
+	}
+}
+
+
+/////////////////////////////////////////////////////
+// FSEObjectTable
+
+FSEObjectTable::FSEObjectTable(const FSEObjectTable& Other)
+{
+	*this = Other;
+}
+
+FSEObjectTable& FSEObjectTable::operator=(const FSEObjectTable& Other)
+{
+	if (this != &Other)
+	{
+		FReadScopeLock OtherLock(Other.Lock);
+		FWriteScopeLock ScopeLock(Lock);
+		Paths = Other.Paths;
+		Records = Other.Records;
+		PathIndices = Other.PathIndices;
+		ObjectIndices = Other.ObjectIndices;
+		Objects = Other.Objects;
+		RecordIndices = Other.RecordIndices;
+		RecordObjects = Other.RecordObjects;
+	}
+	return *this;
+}
+
+int32 FSEObjectTable::Add(const UObject* Object)
+{
+	if (!Object)
+	{
+		return INDEX_NONE;
+	}
+
+	const FObjectKey Key{Object};
+	{
+		FReadScopeLock ScopeLock(Lock);
+		if (const int32* Index = ObjectIndices.Find(Key))
+		{
+			return *Index;
+		}
+	}
+
+	FString Path = Object->GetPathName();
+	FWriteScopeLock ScopeLock(Lock);
+	int32 Index = INDEX_NONE;
+	if (const int32* PathIndex = PathIndices.Find(Path))
+	{
+		// Known path, e.g. from the file these records were loaded from
+		Index = *PathIndex;
+	}
+	else
+	{
+		Index = Paths.Add(Path);
+		Records.Add(INDEX_NONE);
+		Objects.Add(const_cast<UObject*>(Object));
+		PathIndices.Add(MoveTemp(Path), Index);
+	}
+	if (const int32* RecordIndex = RecordIndices.Find(Key))
+	{
+		Records[Index] = *RecordIndex;
+	}
+	ObjectIndices.Add(Key, Index);
+	return Index;
+}
+
+void FSEObjectTable::AddRecordObject(int32 RecordIndex, const UObject* Object)
+{
+	if (!Object || RecordIndex < 0)
+	{
+		return;
+	}
+
+	FWriteScopeLock ScopeLock(Lock);
+	RecordIndices.Add(FObjectKey{Object}, RecordIndex);
+	if (RecordIndex >= RecordObjects.Num())
+	{
+		RecordObjects.SetNum(RecordIndex + 1);
+	}
+	RecordObjects[RecordIndex] = const_cast<UObject*>(Object);
+}
+
+UObject* FSEObjectTable::Resolve(int32 Index, bool bLoadIfFindFails)
+{
+	FString Path;
+	{
+		FReadScopeLock ScopeLock(Lock);
+		if (!Paths.IsValidIndex(Index))
+		{
+			return nullptr;
+		}
+		// Records are found by index. Their names can change if they were respawned
+		const int32 RecordIndex = Records[Index];
+		if (RecordObjects.IsValidIndex(RecordIndex))
+		{
+			if (UObject* Object = RecordObjects[RecordIndex].Get())
+			{
+				return Object;
+			}
+		}
+		if (UObject* Object = Objects[Index].Get())
+		{
+			return Object;
+		}
+		Path = Paths[Index];
+	}
+
+	// Look up the object by fully qualified pathname
+	UObject* Object = FindObject<UObject>(nullptr, *Path, false);
+	// If we couldn't find it, and we want to load it, do that
+	if (!Object && bLoadIfFindFails)
+	{
+		Object = LoadObject<UObject>(nullptr, *Path);
+	}
+
+	if (Object)
+	{
+		FWriteScopeLock ScopeLock(Lock);
+		Objects[Index] = Object;
+	}
+	return Object;
+}
+
+void FSEObjectTable::Reset()
+{
+	FWriteScopeLock ScopeLock(Lock);
+	Paths.Reset();
+	Records.Reset();
+	PathIndices.Reset();
+	ObjectIndices.Reset();
+	Objects.Reset();
+	RecordIndices.Reset();
+	RecordObjects.Reset();
+}
+
+void FSEObjectTable::Remap(TConstArrayView<int32> NewIndices)
+{
+	FWriteScopeLock ScopeLock(Lock);
+	check(NewIndices.Num() == Paths.Num());
+	TArray<FString> NewPaths;
+	TArray<int32> NewRecords;
+	TArray<TWeakObjectPtr<UObject>> NewObjects;
+	NewPaths.SetNum(Paths.Num());
+	NewRecords.SetNum(Paths.Num());
+	NewObjects.SetNum(Paths.Num());
+	for (int32 Index = 0; Index < Paths.Num(); ++Index)
+	{
+		const int32 NewIndex = NewIndices[Index];
+		NewPaths[NewIndex] = MoveTemp(Paths[Index]);
+		NewRecords[NewIndex] = Records[Index];
+		NewObjects[NewIndex] = Objects[Index];
+	}
+	Paths = MoveTemp(NewPaths);
+	Records = MoveTemp(NewRecords);
+	Objects = MoveTemp(NewObjects);
+	for (auto& Entry : PathIndices)
+	{
+		Entry.Value = NewIndices[Entry.Value];
+	}
+	for (auto& Entry : ObjectIndices)
+	{
+		Entry.Value = NewIndices[Entry.Value];
+	}
+}
+
+void FSEObjectTable::Serialize(FArchive& Ar, bool bWithRecords)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEObjectTable::Serialize);
+	FWriteScopeLock ScopeLock(Lock);
+
+	Ar << Paths;
+	if (bWithRecords)
+	{
+		Ar << Records;
+	}
+	if (Ar.IsLoading())
+	{
+		if (Records.Num() != Paths.Num())
+		{
+			Records.Init(INDEX_NONE, Paths.Num());
+		}
+		PathIndices.Reset();
+		PathIndices.Reserve(Paths.Num());
+		for (int32 Index = 0; Index < Paths.Num(); ++Index)
+		{
+			PathIndices.Add(Paths[Index], Index);
+		}
+		ObjectIndices.Reset();
+		Objects.Reset();
+		Objects.SetNum(Paths.Num());
+	}
+}
+
+
 /////////////////////////////////////////////////////
 // FSEArchive
 
+FArchive& FSEArchive::operator<<(FName& Name)
+{
+	if (!Tables.Names)
+	{
+		return FObjectAndNameAsStringProxyArchive::operator<<(Name);
+	}
+
+	int32 Index = IsSaving() ? Tables.Names->Add(Name) : INDEX_NONE;
+	if (IsSaving() && Tables.Fixups)
+	{
+		Tables.Fixups->Add({Tables.FixupComponent, int32(InnerArchive.Tell()), Index, false});
+	}
+	InnerArchive << Index;
+	if (IsLoading())
+	{
+		if (!Tables.Names->IsValidIndex(Index))
+		{
+			SetError();
+		}
+		Name = Tables.Names->Get(Index);
+	}
+	return *this;
+}
+
 FArchive& FSEArchive::operator<<(UObject*& Obj)
 {
+	if (Tables.Objects)
+	{
+		int32 Index = IsSaving() ? Tables.Objects->Add(Obj) : INDEX_NONE;
+		if (IsSaving() && Tables.Fixups && Index != INDEX_NONE)
+		{
+			Tables.Fixups->Add({Tables.FixupComponent, int32(InnerArchive.Tell()), Index, true});
+		}
+		InnerArchive << Index;
+		if (IsLoading())
+		{
+			Obj = Index != INDEX_NONE ? Tables.Objects->Resolve(Index, bLoadIfFindFails) : nullptr;
+		}
+		return *this;
+	}
+
 	if (IsLoading())
 	{
 		// Deserialize the path name to the object
@@ -0,0 +1,760 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#include "Serialization/SEBlockArchive.h"
+
+#include "SaveExtension.h"
+#include "SaveSlot.h"
+
+#include <Async/ParallelFor.h>
+#include <Async/TaskGraphInterfaces.h>
+#include <Compression/OodleDataCompression.h>
+#include <Misc/Compression.h>
+#include <Misc/Guid.h>
+#include <Misc/SecureHash.h>
+#include <atomic>
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+
+namespace SECompression
+{
+	bool IsOodle(ESECompressionCodec Codec)
+	{
+		return Codec != ESECompressionCodec::Zlib && Codec != ESECompressionCodec::LZ4;
+	}
+
+	FName GetFormatName(ESECompressionCodec Codec)
+	{
+		return Codec == ESECompressionCodec::LZ4 ? NAME_LZ4 : NAME_Zlib;
+	}
+
+	FOodleDataCompression::ECompressor GetOodleCompressor(ESECompressionCodec Codec)
+	{
+		switch (Codec)
+		{
+			case ESECompressionCodec::Selkie:
+				return FOodleDataCompression::ECompressor::Selkie;
+			case ESECompressionCodec::Mermaid:
+				return FOodleDataCompression::ECompressor::Mermaid;
+			case ESECompressionCodec::Leviathan:
+				return FOodleDataCompression::ECompressor::Leviathan;
+			default:
+				return FOodleDataCompression::ECompressor::Kraken;
+		}
+	}
+
+	FOodleDataCompression::ECompressionLevel GetOodleLevel(ESECompressionLevel Level)
+	{
+		switch (Level)
+		{
+			case ESECompressionLevel::Fastest:
+				return FOodleDataCompression::ECompressionLevel::SuperFast;
+			case ESECompressionLevel::Fast:
+				return FOodleDataCompression::ECompressionLevel::VeryFast;
+			case ESECompressionLevel::Optimal:
+				return FOodleDataCompression::ECompressionLevel::Optimal2;
+			default:
+				return FOodleDataCompression::ECompressionLevel::Normal;
+		}
+	}
+
+	ECompressionFlags GetFlags(ESECompressionLevel Level)
+	{
+		switch (Level)
+		{
+			case ESECompressionLevel::Fastest:
+			case ESECompressionLevel::Fast:
+				return COMPRESS_BiasSpeed;
+			case ESECompressionLevel::Optimal:
+				return COMPRESS_BiasSize;
+			default:
+				return COMPRESS_NoFlags;
+		}
+	}
+
+	int32 CompressBound(ESECompressionCodec Codec, int32 RawSize)
+	{
+		if (IsOodle(Codec))
+		{
+			return int32(FOodleDataCompression::CompressedBufferSizeNeeded(RawSize));
+		}
+		return FCompression::CompressMemoryBound(GetFormatName(Codec), RawSize);
+	}
+
+	bool Compress(ESECompressionCodec Codec, ESECompressionLevel Level, void* Dest, int32& DestSize,
+		const void* Src, int32 SrcSize)
+	{
+		if (IsOodle(Codec))
+		{
+			const int64 CompressedSize = FOodleDataCompression::Compress(
+				Dest, DestSize, Src, SrcSize, GetOodleCompressor(Codec), GetOodleLevel(Level));
+			DestSize = int32(CompressedSize);
+			return CompressedSize > 0;
+		}
+		return FCompression::CompressMemory(GetFormatName(Codec), Dest, DestSize, Src, SrcSize, GetFlags(Level));
+	}
+
+	bool Decompress(ESECompressionCodec Codec, void* Dest, int32 DestSize, const void* Src, int32 SrcSize)
+	{
+		if (IsOodle(Codec))
+		{
+			return FOodleDataCompression::Decompress(Dest, DestSize, Src, SrcSize);
+		}
+		return FCompression::UncompressMemory(GetFormatName(Codec), Dest, DestSize, Src, SrcSize);
+	}
+
+	int32 GetZlibLevel(ESECompressionLevel Level)
+	{
+		switch (Level)
+		{
+			case ESECompressionLevel::Fastest:
+				return 1;
+			case ESECompressionLevel::Fast:
+				return 3;
+			case ESECompressionLevel::Optimal:
+				return 9;
+			default:
+				return Z_DEFAULT_COMPRESSION;
+		}
+	}
+
+	int32 CompressBoundWithDictionary(int32 RawSize)
+	{
+		// Plus the id of the dictionary in the zlib header
+		return int32(compressBound(uLong(RawSize))) + 4;
+	}
+
+	/** Compresses with zlib, with the dictionary as the history preceding the data.
+	 * UE's Oodle and LZ4 don't expose dictionaries.
+	 */
+	bool CompressWithDictionary(const TArray<uint8>& Dictionary, ESECompressionLevel Level, void* Dest,
+		int32& DestSize, const void* Src, int32 SrcSize)
+	{
+		z_stream Stream{};
+		if (deflateInit(&Stream, GetZlibLevel(Level)) != Z_OK)
+		{
+			return false;
+		}
+		Stream.next_in = static_cast<Bytef*>(const_cast<void*>(Src));
+		Stream.avail_in = uInt(SrcSize);
+		Stream.next_out = static_cast<Bytef*>(Dest);
+		Stream.avail_out = uInt(DestSize);
+		const bool bCompressed =
+			deflateSetDictionary(&Stream, Dictionary.GetData(), uInt(Dictionary.Num())) == Z_OK &&
+			deflate(&Stream, Z_FINISH) == Z_STREAM_END;
+		DestSize = int32(Stream.total_out);
+		deflateEnd(&Stream);
+		return bCompressed;
+	}
+
+	bool DecompressWithDictionary(
+		const TArray<uint8>& Dictionary, void* Dest, int32 DestSize, const void* Src, int32 SrcSize)
+	{
+		z_stream Stream{};
+		if (inflateInit(&Stream) != Z_OK)
+		{
+			return false;
+		}
+		Stream.next_in = static_cast<Bytef*>(const_cast<void*>(Src));
+		Stream.avail_in = uInt(SrcSize);
+		Stream.next_out = static_cast<Bytef*>(Dest);
+		Stream.avail_out = uInt(DestSize);
+		// Zlib asks for the dictionary after checking its id in the header
+		int32 Result = inflate(&Stream, Z_FINISH);
+		if (Result == Z_NEED_DICT &&
+			inflateSetDictionary(&Stream, Dictionary.GetData(), uInt(Dictionary.Num())) == Z_OK)
+		{
+			Result = inflate(&Stream, Z_FINISH);
+		}
+		const bool bDecompressed = Result == Z_STREAM_END && Stream.total_out == uLong(DestSize);
+		inflateEnd(&Stream);
+		return bDecompressed;
+	}
+
+	// Blocks encrypted before they were authenticated store the size of their data before it, padded to the
+	// size of an AES block
+	constexpr int32 EncryptedPrefixSize = sizeof(int32);
+
+	int32 GetEncryptedSize(int32 DataSize)
+	{
+		return Align(EncryptedPrefixSize + DataSize, FAES::AESBlockSize);
+	}
+
+	// Authenticated blocks store the salt of their stream, their encrypted data and its tag
+	constexpr int32 SaltSize = sizeof(uint64);
+	constexpr int32 TagSize = sizeof(FSHAHash::Hash);
+	constexpr int32 AuthenticatedOverhead = SaltSize + TagSize;
+
+	/** Tags are keyed with a hash of the key, so that the same key is never used for two things */
+	void DeriveAuthKey(const FAES::FAESKey& Key, uint8 (&OutAuthKey)[TagSize])
+	{
+		static const ANSICHAR Label[] = "SaveExtension.BlockAuthentication";
+		FSHA1::HMACBuffer(Key.Key, FAES::FAESKey::KeySize, Label, sizeof(Label) - 1, OutAuthKey);
+	}
+
+	/** Encrypts or decrypts in counter mode. The counter of each AES block is the salt of the stream, the index
+	 * of the block in it and the index of the AES block in the block, so no two share it under the same key
+	 */
+	void Crypt(const FAES::FAESKey& Key, uint64 Salt, uint32 BlockIndex, uint8* Data, int32 Size)
+	{
+		TArray<uint8> KeyStream;
+		KeyStream.SetNumUninitialized(Align(Size, FAES::AESBlockSize));
+		for (int32 Counter = 0; Counter * FAES::AESBlockSize < KeyStream.Num(); ++Counter)
+		{
+			uint8* CounterBlock = KeyStream.GetData() + Counter * FAES::AESBlockSize;
+			FMemory::Memcpy(CounterBlock, &Salt, sizeof(Salt));
+			FMemory::Memcpy(CounterBlock + sizeof(Salt), &BlockIndex, sizeof(BlockIndex));
+			FMemory::Memcpy(CounterBlock + sizeof(Salt) + sizeof(BlockIndex), &Counter, sizeof(Counter));
+		}
+		FAES::EncryptData(KeyStream.GetData(), KeyStream.Num(), Key);
+		for (int32 i = 0; i < Size; ++i)
+		{
+			Data[i] ^= KeyStream[i];
+		}
+	}
+
+	/** HMAC-SHA1 of the header of a block, its index in the stream, its salt and its encrypted data.
+	 * Blocks can't be modified, reordered or moved to another stream without their tag failing.
+	 */
+	void ComputeTag(const uint8 (&AuthKey)[TagSize], const int32 (&Header)[2], uint32 BlockIndex,
+		const uint8* Stored, int32 Size, uint8* OutTag)
+	{
+		constexpr int32 PadSize = 64;
+		uint8 Pad[PadSize];
+		uint8 InnerHash[TagSize];
+
+		FMemory::Memset(Pad, 0x36, PadSize);
+		for (int32 i = 0; i < TagSize; ++i)
+		{
+			Pad[i] ^= AuthKey[i];
+		}
+		FSHA1 Inner;
+		Inner.Update(Pad, PadSize);
+		Inner.Update(reinterpret_cast<const uint8*>(Header), sizeof(Header));
+		Inner.Update(reinterpret_cast<const uint8*>(&BlockIndex), sizeof(BlockIndex));
+		Inner.Update(Stored, Size);
+		Inner.Final();
+		Inner.GetHash(InnerHash);
+
+		FMemory::Memset(Pad, 0x5c, PadSize);
+		for (int32 i = 0; i < TagSize; ++i)
+		{
+			Pad[i] ^= AuthKey[i];
+		}
+		FSHA1 Outer;
+		Outer.Update(Pad, PadSize);
+		Outer.Update(InnerHash, TagSize);
+		Outer.Final();
+		Outer.GetHash(OutTag);
+	}
+
+	/** Compares all bytes, so that the time it takes doesn't tell how much of a tag matched */
+	bool TagsMatch(const uint8* A, const uint8* B)
+	{
+		uint8 Difference = 0;
+		for (int32 i = 0; i < TagSize; ++i)
+		{
+			Difference |= A[i] ^ B[i];
+		}
+		return Difference == 0;
+	}
+}	 // namespace SECompression
+
+
+/////////////////////////////////////////////////////
+// FSEBlockWriter
+
+FSEBlockWriter::FSEBlockWriter(FArchive& InInnerArchive, bool bInCompress, ESECompressionCodec InCodec,
+	ESECompressionLevel InLevel, TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> InDictionary,
+	TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> InEncryptionKey)
+	: InnerArchive(InInnerArchive)
+	, bCompress(bInCompress)
+	, Codec(InCodec)
+	, Level(InLevel)
+	, Dictionary(MoveTemp(InDictionary))
+	, EncryptionKey(MoveTemp(InEncryptionKey))
+	, BatchSize(GetBatchSize())
+{
+	SetIsSaving(true);
+	InnerStart = InnerArchive.Tell();
+	if (bCompress)
+	{
+		Block.Reserve(BlockSize);
+	}
+	if (EncryptionKey)
+	{
+		// A new salt for each stream, so that counters are never reused with the same key
+		const FGuid Guid = FGuid::NewGuid();
+		Salt = uint64(Guid.A) << 32 | Guid.B;
+		SECompression::DeriveAuthKey(*EncryptionKey, AuthKey);
+	}
+}
+
+FSEBlockWriter::~FSEBlockWriter()
+{
+	Close();
+}
+
+void FSEBlockWriter::Serialize(void* Data, int64 Num)
+{
+	if (Num <= 0 || IsError())
+	{
+		return;
+	}
+
+	if (!bCompress)
+	{
+		WriteInner(Data, Num);
+		RawHash.Update(Data, Num);
+		Position += Num;
+		return;
+	}
+
+	const uint8* Src = static_cast<const uint8*>(Data);
+	while (Num > 0)
+	{
+		const int64 BlockPosition = Position - BlockOffset;
+		// Fill the block up to its size. A seek backwards may have left us in the middle of it
+		const int64 Count = FMath::Min<int64>(Num, FMath::Max(BlockSize, Block.Num()) - BlockPosition);
+		const int64 End = BlockPosition + Count;
+		if (End > Block.Num())
+		{
+			Block.SetNumUninitialized(int32(End), false);
+		}
+		FMemory::Memcpy(Block.GetData() + BlockPosition, Src, Count);
+		Src += Count;
+		Num -= Count;
+		Position += Count;
+
+		if (Block.Num() >= BlockSize && Position == BlockOffset + Block.Num())
+		{
+			QueueBlock();
+		}
+	}
+}
+
+int64 FSEBlockWriter::TotalSize()
+{
+	if (!bCompress)
+	{
+		return InnerArchive.TotalSize() - InnerStart;
+	}
+	return BlockOffset + Block.Num();
+}
+
+void FSEBlockWriter::Seek(int64 InPos)
+{
+	if (!bCompress)
+	{
+		// Bytes already hashed may be overwritten
+		bStoredHashValid &= InPos == Position;
+		bRawHashValid &= InPos == Position;
+		InnerArchive.Seek(InnerStart + InPos);
+		Position = InPos;
+		return;
+	}
+
+	// Filled blocks can't be patched
+	if (InPos < BlockOffset || InPos > BlockOffset + Block.Num())
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Can't seek to %lld. Only the last block (%lld - %lld) can be modified."),
+			InPos, BlockOffset, BlockOffset + Block.Num());
+		SetError();
+		return;
+	}
+	Position = InPos;
+}
+
+bool FSEBlockWriter::Close()
+{
+	if (bCompress)
+	{
+		if (Block.Num() > 0)
+		{
+			QueueBlock();
+		}
+		FlushBlocks();
+	}
+	return !IsError();
+}
+
+int32 FSEBlockWriter::GetBatchSize()
+{
+	// One block per worker, capped to keep memory bound
+	return FMath::Clamp(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1, 16);
+}
+
+void FSEBlockWriter::WriteInner(const void* Data, int64 Num)
+{
+	InnerArchive.Serialize(const_cast<void*>(Data), Num);
+	StoredHash.Update(Data, Num);
+}
+
+void FSEBlockWriter::QueueBlock()
+{
+	if (PendingBlocks.Num() <= NumPendingBlocks)
+	{
+		PendingBlocks.AddDefaulted();
+	}
+	TArray<uint8>& PendingBlock = PendingBlocks[NumPendingBlocks++];
+	Swap(PendingBlock, Block);
+	Block.Reset();
+	Block.Reserve(BlockSize);
+	// Queued blocks can't be patched anymore
+	RawHash.Update(PendingBlock.GetData(), PendingBlock.Num());
+
+	BlockOffset += PendingBlock.Num();
+	Position = BlockOffset;
+
+	if (NumPendingBlocks >= BatchSize)
+	{
+		FlushBlocks();
+	}
+}
+
+void FSEBlockWriter::FlushBlocks()
+{
+	if (NumPendingBlocks <= 0)
+	{
+		return;
+	}
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEBlockWriter::FlushBlocks);
+
+	CompressedBlocks.SetNum(NumPendingBlocks, false);
+	CompressedSizes.SetNumUninitialized(NumPendingBlocks, false);
+	ParallelFor(NumPendingBlocks, [this](int32 Index) {
+		const TArray<uint8>& RawBlock = PendingBlocks[Index];
+		TArray<uint8>& CompressedBlock = CompressedBlocks[Index];
+		const int32 Prefix = EncryptionKey ? SECompression::SaltSize : 0;
+		int32 CompressedSize = Dictionary ? SECompression::CompressBoundWithDictionary(RawBlock.Num())
+										  : SECompression::CompressBound(Codec, RawBlock.Num());
+		CompressedBlock.SetNumUninitialized(EncryptionKey
+			? SECompression::AuthenticatedOverhead + FMath::Max(CompressedSize, RawBlock.Num())
+			: CompressedSize, false);
+		uint8* CompressedData = CompressedBlock.GetData() + Prefix;
+		const bool bCompressed = Dictionary
+			? SECompression::CompressWithDictionary(*Dictionary, Level, CompressedData, CompressedSize,
+				  RawBlock.GetData(), RawBlock.Num())
+			: SECompression::Compress(Codec, Level, CompressedData, CompressedSize, RawBlock.GetData(),
+				  RawBlock.Num());
+		if (!bCompressed || CompressedSize >= RawBlock.Num())
+		{
+			// Not worth compressing
+			CompressedSize = 0;
+		}
+
+		if (EncryptionKey)
+		{
+			// Stored blocks are encrypted too. Their data is as big as the raw block
+			int32 DataSize = CompressedSize;
+			if (DataSize <= 0)
+			{
+				DataSize = RawBlock.Num();
+				FMemory::Memcpy(CompressedData, RawBlock.GetData(), DataSize);
+			}
+			const uint32 BlockIndex = uint32(NumWrittenBlocks + Index);
+			FMemory::Memcpy(CompressedBlock.GetData(), &Salt, Prefix);
+			SECompression::Crypt(*EncryptionKey, Salt, BlockIndex, CompressedData, DataSize);
+
+			CompressedSize = SECompression::AuthenticatedOverhead + DataSize;
+			const int32 Header[2]{CompressedSize, RawBlock.Num()};
+			SECompression::ComputeTag(AuthKey, Header, BlockIndex, CompressedBlock.GetData(), Prefix + DataSize,
+				CompressedData + DataSize);
+		}
+		CompressedSizes[Index] = CompressedSize;
+	});
+
+	// Written in order
+	for (int32 Index = 0; Index < NumPendingBlocks; ++Index)
+	{
+		TArray<uint8>& RawBlock = PendingBlocks[Index];
+		int32 RawSize = RawBlock.Num();
+		int32 CompressedSize = CompressedSizes[Index];
+		if (CompressedSize > 0)
+		{
+			const int32 Header[2]{CompressedSize, RawSize};
+			WriteInner(Header, sizeof(Header));
+			WriteInner(CompressedBlocks[Index].GetData(), CompressedSize);
+		}
+		else
+		{
+			// Same sizes mark the block as stored
+			const int32 Header[2]{RawSize, RawSize};
+			WriteInner(Header, sizeof(Header));
+			WriteInner(RawBlock.GetData(), RawSize);
+		}
+		RawBlock.Reset();
+	}
+	NumWrittenBlocks += NumPendingBlocks;
+	NumPendingBlocks = 0;
+}
+
+
+/////////////////////////////////////////////////////
+// FSEBlockReader
+
+FSEBlockReader::FSEBlockReader(FArchive& InInnerArchive, bool bInCompressed, ESECompressionCodec InCodec,
+	int64 InRawSize, TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> InDictionary,
+	TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> InEncryptionKey, bool bInAuthenticated)
+	: InnerArchive(InInnerArchive)
+	, bCompressed(bInCompressed)
+	, Codec(InCodec)
+	, Dictionary(MoveTemp(InDictionary))
+	, EncryptionKey(MoveTemp(InEncryptionKey))
+	, bAuthenticated(bInAuthenticated)
+	, RawSize(InRawSize)
+	, BatchSize(FSEBlockWriter::GetBatchSize())
+{
+	SetIsLoading(true);
+	InnerStart = InnerArchive.Tell();
+	if (EncryptionKey && bAuthenticated)
+	{
+		SECompression::DeriveAuthKey(*EncryptionKey, AuthKey);
+	}
+}
+
+void FSEBlockReader::Serialize(void* Data, int64 Num)
+{
+	if (Num <= 0 || IsError())
+	{
+		return;
+	}
+
+	if (Position + Num > RawSize)
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Tried to read %lld bytes past the end of a block stream (%lld)."),
+			Position + Num - RawSize, RawSize);
+		SetError();
+		return;
+	}
+
+	if (!bCompressed)
+	{
+		ReadInner(Data, Num);
+		Position += Num;
+		return;
+	}
+
+	uint8* Dest = static_cast<uint8*>(Data);
+	while (Num > 0)
+	{
+		if (Position >= GetBlockEnd() && !ReadBlock())
+		{
+			return;
+		}
+		const TArray<uint8>& Block = Blocks[CurrentBlock];
+		const int64 BlockPosition = Position - BlockOffset;
+		const int64 Count = FMath::Min<int64>(Num, Block.Num() - BlockPosition);
+		FMemory::Memcpy(Dest, Block.GetData() + BlockPosition, Count);
+		Dest += Count;
+		Num -= Count;
+		Position += Count;
+	}
+}
+
+void FSEBlockReader::Seek(int64 InPos)
+{
+	if (!bCompressed)
+	{
+		bStoredHashValid &= InPos == Position;
+		InnerArchive.Seek(InnerStart + InPos);
+		Position = InPos;
+		return;
+	}
+
+	if (InPos < BlockOffset || InPos > RawSize)
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Can't seek back to %lld. Only the current block (%lld - %lld) can be read."),
+			InPos, BlockOffset, GetBlockEnd());
+		SetError();
+		return;
+	}
+
+	// Skip forward block by block
+	while (InPos > GetBlockEnd())
+	{
+		Position = GetBlockEnd();
+		if (!ReadBlock())
+		{
+			return;
+		}
+	}
+	Position = InPos;
+}
+
+void FSEBlockReader::ReadInner(void* Data, int64 Num)
+{
+	InnerArchive.Serialize(Data, Num);
+	StoredHash.Update(Data, Num);
+}
+
+bool FSEBlockReader::ReadBlock()
+{
+	BlockOffset = GetBlockEnd();
+	++CurrentBlock;
+	if (CurrentBlock < NumBlocks)
+	{
+		return true;
+	}
+	return ReadBatch();
+}
+
+bool FSEBlockReader::ReadBatch()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEBlockReader::ReadBatch);
+	NumBlocks = 0;
+	CurrentBlock = 0;
+
+	// Read a batch of blocks sequentially
+	const int32 FirstBlockIndex = NumReadBlocks;
+	TArray<int32, TInlineAllocator<16>> CompressedSizes;
+	while (NumBlocks < BatchSize && RawRead < RawSize)
+	{
+		int32 Header[2]{0, 0};
+		ReadInner(Header, sizeof(Header));
+		const int32 CompressedSize = Header[0];
+		const int32 BlockRawSize = Header[1];
+		bool bValidSize = CompressedSize <= BlockRawSize;
+		if (EncryptionKey && bAuthenticated)
+		{
+			const int32 DataSize = CompressedSize - SECompression::AuthenticatedOverhead;
+			bValidSize = DataSize > 0 && DataSize <= BlockRawSize;
+		}
+		else if (EncryptionKey)
+		{
+			bValidSize = CompressedSize % FAES::AESBlockSize == 0 &&
+				CompressedSize <= SECompression::GetEncryptedSize(FMath::Max(BlockRawSize, 0));
+		}
+		if (InnerArchive.IsError() || CompressedSize <= 0 || BlockRawSize <= 0 || !bValidSize)
+		{
+			UE_LOG(LogSaveExtension, Error, TEXT("Found a corrupted block at %lld."), RawRead);
+			SetError();
+			return false;
+		}
+
+		if (Blocks.Num() <= NumBlocks)
+		{
+			Blocks.AddDefaulted();
+			CompressedBlocks.AddDefaulted();
+		}
+		TArray<uint8>& Block = Blocks[NumBlocks];
+		Block.SetNumUninitialized(BlockRawSize, false);
+		if (CompressedSize == BlockRawSize && !EncryptionKey)
+		{
+			ReadInner(Block.GetData(), BlockRawSize);
+			CompressedSizes.Add(0);
+		}
+		else
+		{
+			TArray<uint8>& CompressedBlock = CompressedBlocks[NumBlocks];
+			CompressedBlock.SetNumUninitialized(CompressedSize, false);
+			ReadInner(CompressedBlock.GetData(), CompressedSize);
+			CompressedSizes.Add(CompressedSize);
+
+			if (EncryptionKey && bAuthenticated && !InnerArchive.IsError())
+			{
+				// All blocks of a stream share its salt. Blocks of other streams are rejected
+				uint64 BlockSalt = 0;
+				FMemory::Memcpy(&BlockSalt, CompressedBlock.GetData(), SECompression::SaltSize);
+				if (NumReadBlocks == 0)
+				{
+					Salt = BlockSalt;
+				}
+				else if (BlockSalt != Salt)
+				{
+					UE_LOG(LogSaveExtension, Error, TEXT("Found a block of another stream at %lld."), RawRead);
+					SetError();
+					return false;
+				}
+			}
+		}
+		RawRead += BlockRawSize;
+		++NumBlocks;
+		++NumReadBlocks;
+	}
+
+	if (NumBlocks <= 0 || InnerArchive.IsError())
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Failed to read blocks at %lld."), RawRead);
+		SetError();
+		return false;
+	}
+
+	// Then decompress them in parallel
+	std::atomic<bool> bFailed = false;
+	std::atomic<bool> bForged = false;
+	ParallelFor(NumBlocks, [this, &CompressedSizes, &bFailed, &bForged, FirstBlockIndex](int32 Index) {
+		if (CompressedSizes[Index] <= 0)
+		{
+			return;
+		}
+		TArray<uint8>& Block = Blocks[Index];
+		uint8* CompressedData = CompressedBlocks[Index].GetData();
+		int32 CompressedSize = CompressedSizes[Index];
+		if (EncryptionKey && bAuthenticated)
+		{
+			// Checked before decrypting. A different key fails here too
+			const uint32 BlockIndex = uint32(FirstBlockIndex + Index);
+			const int32 DataSize = CompressedSize - SECompression::AuthenticatedOverhead;
+			const int32 Header[2]{CompressedSize, Block.Num()};
+			uint8 Tag[SECompression::TagSize];
+			SECompression::ComputeTag(
+				AuthKey, Header, BlockIndex, CompressedData, SECompression::SaltSize + DataSize, Tag);
+			CompressedData += SECompression::SaltSize;
+			if (!SECompression::TagsMatch(Tag, CompressedData + DataSize))
+			{
+				bForged = true;
+				return;
+			}
+			SECompression::Crypt(*EncryptionKey, Salt, BlockIndex, CompressedData, DataSize);
+			CompressedSize = DataSize;
+			if (CompressedSize == Block.Num())
+			{
+				FMemory::Memcpy(Block.GetData(), CompressedData, CompressedSize);
+				return;
+			}
+		}
+		else if (EncryptionKey)
+		{
+			const int32 Prefix = SECompression::EncryptedPrefixSize;
+			FAES::DecryptData(CompressedData, CompressedSize, *EncryptionKey);
+			FMemory::Memcpy(&CompressedSize, CompressedData, Prefix);
+			CompressedData += Prefix;
+			if (CompressedSize <= 0 || CompressedSize > CompressedSizes[Index] - Prefix)
+			{
+				// Most likely a different key
+				bFailed = true;
+				return;
+			}
+			if (CompressedSize == Block.Num())
+			{
+				FMemory::Memcpy(Block.GetData(), CompressedData, CompressedSize);
+				return;
+			}
+		}
+		const bool bDecompressed = Dictionary
+			? SECompression::DecompressWithDictionary(
+				  *Dictionary, Block.GetData(), Block.Num(), CompressedData, CompressedSize)
+			: SECompression::Decompress(Codec, Block.GetData(), Block.Num(), CompressedData, CompressedSize);
+		if (!bDecompressed)
+		{
+			bFailed = true;
+		}
+	});
+	if (bForged)
+	{
+		UE_LOG(LogSaveExtension, Error,
+			TEXT("Failed to authenticate blocks before %lld. They were modified or the key is different."), RawRead);
+		SetError();
+		return false;
+	}
+	if (bFailed)
+	{
+		UE_LOG(LogSaveExtension, Error, TEXT("Failed to decompress blocks before %lld."), RawRead);
+		SetError();
+		return false;
+	}
+	return true;
+}
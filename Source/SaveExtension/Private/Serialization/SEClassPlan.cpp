@@ -0,0 +1,172 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#include "Serialization/SEClassPlan.h"
+
+#include "SaveExtension.h"
+
+#include <Components/PrimitiveComponent.h>
+#include <Misc/ScopeRWLock.h>
+#include <Serialization/StructuredArchive.h>
+#include <UObject/ObjectKey.h>
+#include <UObject/UObjectGlobals.h>
+
+
+static FRWLock PlansLock;
+static TMap<FObjectKey, TSharedRef<const FSEClassPlan, ESPMode::ThreadSafe>> Plans;
+static FDelegateHandle ReloadCompleteHandle;
+static FDelegateHandle ObjectsReinstancedHandle;
+
+
+FSEClassPlan::FSEClassPlan(const UClass* Class)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSEClassPlan::FSEClassPlan);
+	check(Class);
+	bStoresData = !Class->IsChildOf<UPrimitiveComponent>();
+
+	// Same properties UObject::Serialize stores with a save game archive
+	constexpr EPropertyFlags SkipFlags = CPF_Transient | CPF_Deprecated | CPF_SkipSerialization;
+	for (TFieldIterator<FProperty> It(Class); It; ++It)
+	{
+		const FProperty* Property = *It;
+		if (!Property->HasAnyPropertyFlags(CPF_SaveGame) || Property->HasAnyPropertyFlags(SkipFlags))
+		{
+			continue;
+		}
+
+		FString ExtendedType;
+		const FString Type = Property->GetCPPType(&ExtendedType, 0) + ExtendedType;
+		EntryIndices.Add(Property->GetFName(), Entries.Num());
+		Entries.Add({Property, Property->GetFName(), Property->GetOffset_ForInternal(),
+			HashCombine(GetTypeHash(Type), GetTypeHash(Property->ArrayDim))});
+	}
+}
+
+void FSEClassPlan::Serialize(FArchive& Ar, UObject* Object) const
+{
+	check(Object);
+	FStructuredArchiveFromArchive StructuredAr(Ar);
+	FStructuredArchive::FStream Stream = StructuredAr.GetSlot().EnterStream();
+
+	if (Ar.IsSaving())
+	{
+		int32 Num = Entries.Num();
+		Ar << Num;
+		for (const FEntry& Entry : Entries)
+		{
+			FName Name = Entry.Name;
+			uint32 TypeHash = Entry.TypeHash;
+			int32 Size = 0;
+			Ar << Name;
+			Ar << TypeHash;
+			const int64 SizeOffset = Ar.Tell();
+			Ar << Size;
+
+			SerializeValue(Stream, Entry, Object);
+
+			// Sizes let loading skip properties that don't match anymore
+			const int64 End = Ar.Tell();
+			Size = int32(End - SizeOffset - sizeof(int32));
+			Ar.Seek(SizeOffset);
+			Ar << Size;
+			Ar.Seek(End);
+		}
+		return;
+	}
+
+	int32 Num = 0;
+	Ar << Num;
+	for (int32 i = 0; i < Num && !Ar.IsError(); ++i)
+	{
+		FName Name;
+		uint32 TypeHash = 0;
+		int32 Size = 0;
+		Ar << Name;
+		Ar << TypeHash;
+		Ar << Size;
+		const int64 End = Ar.Tell() + Size;
+		if (Ar.IsError() || Size < 0 || End > Ar.TotalSize())
+		{
+			Ar.SetError();
+			return;
+		}
+
+		const int32* Index = EntryIndices.Find(Name);
+		if (!Index)
+		{
+			// Removed or no longer saved
+			Ar.Seek(End);
+			continue;
+		}
+
+		const FEntry& Entry = Entries[*Index];
+		if (Entry.TypeHash != TypeHash)
+		{
+			UE_LOG(LogSaveExtension, Log, TEXT("Property '%s' of '%s' changed its type since it was saved"),
+				*Name.ToString(), *Object->GetName());
+		}
+		else
+		{
+			SerializeValue(Stream, Entry, Object);
+			if (Ar.Tell() != End)
+			{
+				UE_LOG(LogSaveExtension, Warning, TEXT("Property '%s' of '%s' read %lld bytes instead of %i"),
+					*Name.ToString(), *Object->GetName(), Ar.Tell() - (End - Size), Size);
+			}
+		}
+		Ar.Seek(End);
+	}
+}
+
+void FSEClassPlan::SerializeValue(
+	FStructuredArchive::FStream& Stream, const FEntry& Entry, UObject* Object) const
+{
+	uint8* Value = reinterpret_cast<uint8*>(Object) + Entry.Offset;
+	const int32 ElementSize = Entry.Property->GetElementSize();
+	for (int32 i = 0; i < Entry.Property->ArrayDim; ++i)
+	{
+		Entry.Property->SerializeItem(Stream.EnterElement(), Value + i * ElementSize, nullptr);
+	}
+}
+
+TSharedRef<const FSEClassPlan, ESPMode::ThreadSafe> FSEClassPlan::Get(const UClass* Class)
+{
+	const FObjectKey Key{Class};
+	{
+		FReadScopeLock ReadLock(PlansLock);
+		if (const TSharedRef<const FSEClassPlan, ESPMode::ThreadSafe>* Plan = Plans.Find(Key))
+		{
+			return *Plan;
+		}
+	}
+
+	// Built outside of the lock. If another thread built it first, theirs is kept
+	TSharedRef<const FSEClassPlan, ESPMode::ThreadSafe> Plan =
+		MakeShared<const FSEClassPlan, ESPMode::ThreadSafe>(Class);
+	FWriteScopeLock WriteLock(PlansLock);
+	return Plans.FindOrAdd(Key, MoveTemp(Plan));
+}
+
+void FSEClassPlan::Reset()
+{
+	FWriteScopeLock WriteLock(PlansLock);
+	Plans.Empty();
+}
+
+void FSEClassPlan::RegisterDelegates()
+{
+	ReloadCompleteHandle = FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda([](EReloadCompleteReason) {
+		Reset();
+	});
+	// Recompiled blueprints change the properties of their classes
+	ObjectsReinstancedHandle =
+		FCoreUObjectDelegates::OnObjectsReinstanced.AddLambda([](const TMap<UObject*, UObject*>&) {
+			Reset();
+		});
+}
+
+void FSEClassPlan::UnregisterDelegates()
+{
+	FCoreUObjectDelegates::ReloadCompleteDelegate.Remove(ReloadCompleteHandle);
+	FCoreUObjectDelegates::OnObjectsReinstanced.Remove(ObjectsReinstancedHandle);
+	Reset();
+}
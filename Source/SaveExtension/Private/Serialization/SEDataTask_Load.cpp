@@ -22,6 +22,7 @@
 
 FSEDataTask_Load::FSEDataTask_Load(USaveManager* Manager, USaveSlot* Slot)
 	: FSEDataTask(Manager, ESETaskType::Load)
+	, Slot(Slot)
 	, SlotData(Slot->GetData())
 	, MaxFrameMs(Slot->GetMaxFrameMs())
 {}
@@ -32,6 +33,10 @@ FSEDataTask_Load::~FSEDataTask_Load()
 	{
 		LoadFileTask.Wait();
 	}
+	if (!LoadLevelsTask.IsCompleted())
+	{
+		LoadLevelsTask.Wait();
+	}
 }
 
 void FSEDataTask_Load::OnStart()
@@ -47,8 +52,14 @@ void FSEDataTask_Load::OnStart()
 		return;
 	}
 
-	// We load data while the map opens or GC runs
+	// Data is read and verified before opening a different map. Otherwise, while GC runs
 	StartLoadingFile();
+	if (!Slot)
+	{
+		// Read synchronously and failed
+		Finish(false);
+		return;
+	}
 
 	const UWorld* World = GetWorld();
 
@@ -57,23 +68,14 @@ void FSEDataTask_Load::OnStart()
 	FName CurrentMapName{GetWorldName(World)};
 	if (CurrentMapName != Slot->Map)
 	{
-		LoadState = ELoadDataTaskState::LoadingMap;
-		FString MapToOpen = Slot->Map.ToString();
-		if (!GEngine->MakeSureMapNameIsValid(MapToOpen))
+		if (CheckFileLoaded())
 		{
-			UE_LOG(LogSaveExtension, Warning,
-				TEXT("Slot '%s' was saved in map '%s' but it did not exist while loading. Corrupted save "
-					 "file?"),
-				*Slot->Name.ToString(), *MapToOpen);
-			Finish(false);
-			return;
+			OpenSlotMap();
+		}
+		else
+		{
+			LoadState = ELoadDataTaskState::ReadingFile;
 		}
-
-		UGameplayStatics::OpenLevel(Manager, FName{MapToOpen});
-
-		SELog(Slot,
-			"Slot '" + SlotName.ToString() + "' is recorded on another Map. Loading before charging slot.",
-			FColor::White, false, 1);
 		return;
 	}
 	else if (CheckFileLoaded())
@@ -98,6 +100,13 @@ void FSEDataTask_Load::Tick(float DeltaTime)
 			}
 			break;
 
+		case ELoadDataTaskState::ReadingFile:
+			if (CheckFileLoaded())
+			{
+				OpenSlotMap();
+			}
+			break;
+
 		case ELoadDataTaskState::WaitingForData:
 			if (CheckFileLoaded())
 			{
@@ -106,6 +115,34 @@ void FSEDataTask_Load::Tick(float DeltaTime)
 	}
 }
 
+void FSEDataTask_Load::OpenSlotMap()
+{
+	if (!Slot || !SlotData)
+	{
+		// Corrupted or missing. Don't open the map for nothing
+		Finish(false);
+		return;
+	}
+
+	LoadState = ELoadDataTaskState::LoadingMap;
+	FString MapToOpen = Slot->Map.ToString();
+	if (!GEngine->MakeSureMapNameIsValid(MapToOpen))
+	{
+		UE_LOG(LogSaveExtension, Warning,
+			TEXT("Slot '%s' was saved in map '%s' but it did not exist while loading. Corrupted save "
+				 "file?"),
+			*Slot->Name.ToString(), *MapToOpen);
+		Finish(false);
+		return;
+	}
+
+	UGameplayStatics::OpenLevel(Manager, FName{MapToOpen});
+
+	SELog(Slot,
+		"Slot '" + SlotName.ToString() + "' is recorded on another Map. Loading before charging slot.",
+		FColor::White, false, 1);
+}
+
 void FSEDataTask_Load::OnFinish(bool bSuccess)
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(FSEDataTask_Load::OnFinish);
@@ -150,17 +187,37 @@ void FSEDataTask_Load::OnMapLoaded()
 void FSEDataTask_Load::StartDeserialization()
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(FSEDataTask_Load::StartDeserialization);
-	check(Slot);
 
 	LoadState = ELoadDataTaskState::Deserializing;
 
-	if (!SlotData)
+	if (!Slot || !SlotData)
 	{
 		// Failed to load data
 		Finish(false);
 		return;
 	}
 
+	// Records of loaded streaming levels may still be on disk
+	if (!LoadLevelsTask.IsValid())
+	{
+		TArray<FName> PendingLevels;
+		for (const ULevelStreaming* Level : GetWorld()->GetStreamingLevels())
+		{
+			const FLevelRecord* LevelRecord =
+				Level->IsLevelLoaded() ? FindLevelRecord(*SlotData, Level) : nullptr;
+			if (LevelRecord && LevelRecord->IsPending())
+			{
+				PendingLevels.Add(LevelRecord->Name);
+			}
+		}
+		StartLoadingLevels(MoveTemp(PendingLevels));
+	}
+	if (!CheckLevelsLoaded())
+	{
+		LoadState = ELoadDataTaskState::WaitingForData;
+		return;
+	}
+
 	Slot->Stats.LoadDate = FDateTime::Now();
 
 	// Apply current Info if succeeded
@@ -191,12 +248,31 @@ bool FSEDataTask_Load::CheckFileLoaded()
 	if (LoadFileTask.IsCompleted())
 	{
 		Slot = LoadFileTask.GetResult();
-		SlotData = Slot->GetData();
+		SlotData = Slot ? Slot->GetData() : nullptr;
 		return true;
 	}
 	return false;
 }
 
+void FSEDataTask_Load::StartLoadingLevels(TArray<FName> LevelNames)
+{
+	if (LevelNames.IsEmpty())
+	{
+		return;
+	}
+
+	LoadLevelsTask = FSEFileHelpers::LoadLevels(SlotData, MoveTemp(LevelNames));
+	if (!Slot->ShouldLoadFileAsync())
+	{
+		LoadLevelsTask.Wait();
+	}
+}
+
+bool FSEDataTask_Load::CheckLevelsLoaded() const
+{
+	return !LoadLevelsTask.IsValid() || LoadLevelsTask.IsCompleted();
+}
+
 void FSEDataTask_Load::BeforeDeserialize()
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(FSEDataTask_Load::BeforeDeserialize);
@@ -215,7 +291,7 @@ void FSEDataTask_Load::BeforeDeserialize()
 		if (GameInstance->GetClass() == SlotData->GameInstance.Class)
 		{
 			// Serialize from Record Data
-			FMemoryReader MemoryReader(SlotData->GameInstance.Data, true);
+			FMemoryReaderView MemoryReader(SlotData->GameInstance.GetData(), true);
 			FSEArchive Archive(MemoryReader, false);
 			GameInstance->Serialize(Archive);
 		}
@@ -226,7 +302,7 @@ void FSEDataTask_Load::BeforeDeserialize()
 			{
 				if (USubsystem* Subsystem = GameInstance->GetSubsystemBase(SubsystemRecord.Class))
 				{
-					FMemoryReader SubsystemMemoryReader(SubsystemRecord.Data, true);
+					FMemoryReaderView SubsystemMemoryReader(SubsystemRecord.GetData(), true);
 					FSEArchive Ar(SubsystemMemoryReader, false);
 					Subsystem->Serialize(Ar);
 				}
@@ -240,7 +316,7 @@ void FSEDataTask_Load::BeforeDeserialize()
 		{
 			if (USubsystem* Subsystem = World->GetSubsystemBase(SubsystemRecord.Class))
 			{
-				FMemoryReader SubsystemMemoryReader(SubsystemRecord.Data, true);
+				FMemoryReaderView SubsystemMemoryReader(SubsystemRecord.GetData(), true);
 				FSEArchive Ar(SubsystemMemoryReader, false);
 				Subsystem->Serialize(Ar);
 			}
@@ -289,13 +365,14 @@ void FSEDataTask_Load::DeserializeLevelSync(const ULevel* Level, const ULevelStr
 		StreamingLevel ? StreamingLevel->GetWorldAssetPackageFName() : FPersistentLevelRecord::PersistentName;
 	SELog(Slot, "Level '" + LevelName.ToString() + "'", FColor::Green, false, 1);
 
-	const FLevelRecord& LevelRecord = *FindLevelRecord(*SlotData, StreamingLevel);
+	FLevelRecord& LevelRecord = *FindLevelRecord(*SlotData, StreamingLevel);
 	for (const auto& RecordToActor : LevelRecord.RecordsToActors)
 	{
 		const FActorRecord* Record = RecordToActor.Key;
 		AActor* Actor = RecordToActor.Value.Get();
 		check(Record && Actor);
-		SERecords::DeserializeActor(Actor, *Record, LevelRecord.Filter.ComponentFilter);
+		SERecords::DeserializeActor(
+			Actor, *Record, LevelRecord.Filter.ComponentFilter, LevelRecord.GetTables());
 	}
 }
 
@@ -355,7 +432,8 @@ void FSEDataTask_Load::DeserializeASyncLoop(float StartMS)
 		{
 			continue;
 		}
-		SERecords::DeserializeActor(Actor, *Record, LevelRecord.Filter.ComponentFilter);
+		SERecords::DeserializeActor(
+			Actor, *Record, LevelRecord.Filter.ComponentFilter, LevelRecord.GetTables());
 
 		const float CurrentMS = GetTimeMilliseconds();
 		if (CurrentMS - StartMS >= MaxFrameMs)
@@ -438,6 +516,16 @@ void FSEDataTask_Load::PrepareLevel(const ULevel* Level, FLevelRecord& LevelReco
 	// Spawn Actors that don't exist but were saved
 	ActorRecordsToSpawn.Shrink();
 	RespawnActors(ActorRecordsToSpawn, Level, LevelRecord);
+
+	// References to records are resolved from here instead of by name
+	for (const auto& RecordToActor : LevelRecord.RecordsToActors)
+	{
+		const int32 RecordIndex = int32(RecordToActor.Key - LevelRecord.Actors.GetData());
+		if (LevelRecord.Actors.IsValidIndex(RecordIndex))
+		{
+			LevelRecord.Objects.AddRecordObject(RecordIndex, RecordToActor.Value.Get());
+		}
+	}
 }
 
 void FSEDataTask_Load::FinishedDeserializing()
@@ -23,6 +23,42 @@ void FSEDataTask_LoadLevel::OnStart()
 		return;
 	}
 
+	if (LevelRecord->IsPending())
+	{
+		// Only this level's records are read from the file
+		StartLoadingLevels({LevelRecord->Name});
+		if (!CheckLevelsLoaded())
+		{
+			LoadState = ELoadDataTaskState::WaitingForData;
+			return;
+		}
+	}
+	StartLevelDeserialization();
+}
+
+void FSEDataTask_LoadLevel::Tick(float DeltaTime)
+{
+	if (LoadState == ELoadDataTaskState::WaitingForData)
+	{
+		if (CheckLevelsLoaded())
+		{
+			StartLevelDeserialization();
+		}
+		return;
+	}
+	FSEDataTask_Load::Tick(DeltaTime);
+}
+
+void FSEDataTask_LoadLevel::StartLevelDeserialization()
+{
+	FLevelRecord* LevelRecord = FindLevelRecord(*SlotData, StreamingLevel);
+	if (!LevelRecord || !StreamingLevel->IsLevelLoaded())
+	{
+		Finish(false);
+		return;
+	}
+
+	LoadState = ELoadDataTaskState::Deserializing;
 	PrepareLevel(StreamingLevel->GetLoadedLevel(), *LevelRecord);
 
 	if (Slot->IsFrameSplitLoad())
@@ -59,7 +95,8 @@ void FSEDataTask_LoadLevel::DeserializeASyncLoop(float StartMS /*= 0.0f*/)
 		{
 			continue;
 		}
-		SERecords::DeserializeActor(Actor, *Record, LevelRecord.Filter.ComponentFilter);
+		SERecords::DeserializeActor(
+			Actor, *Record, LevelRecord.Filter.ComponentFilter, LevelRecord.GetTables());
 
 		const float CurrentMS = GetTimeMilliseconds();
 		if (CurrentMS - StartMS >= MaxFrameMs)
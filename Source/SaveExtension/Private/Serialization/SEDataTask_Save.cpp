@@ -41,22 +41,12 @@ void FSEDataTask_Save::OnStart()
 	bool bSave = true;
 	const FString SlotNameStr = SlotName.ToString();
 	// Overriding
+	// Previous saves are not deleted. The new file replaces them once it is completely written
+	if (!bOverride)
 	{
-		const bool bFileExists = FSEFileHelpers::FileExists(SlotNameStr);
-		if (bOverride)
-		{
-			// Delete previous save
-			if (bFileExists)
-			{
-				FSEFileHelpers::DeleteFile(SlotNameStr);
-			}
-		}
-		else
-		{
-			// Only save if previous files don't exist
-			// We don't want to serialize since it won't be saved anyway
-			bSave = !bFileExists;
-		}
+		// Only save if previous files don't exist
+		// We don't want to serialize since it won't be saved anyway
+		bSave = !FSEFileHelpers::FileExists(SlotNameStr);
 	}
 
 	if (!bSave)
@@ -231,8 +221,12 @@ void FSEDataTask_Save::PrepareAllLevels(const TArray<ULevelStreaming*>& Levels)
 	{
 		if (Level->IsLevelLoaded())
 		{
-			FLevelRecord& LevelRecord = SlotData->SubLevels.Add_GetRef({*Level});
-			PrepareLevel(Level->GetLoadedLevel(), LevelRecord);
+			FLevelRecord* LevelRecord = FindLevelRecord(*SlotData, Level);
+			if (!LevelRecord)
+			{
+				LevelRecord = &SlotData->SubLevels.Add_GetRef({*Level});
+			}
+			PrepareLevel(Level->GetLoadedLevel(), *LevelRecord);
 		}
 	}
 }
@@ -257,6 +251,7 @@ void FSEDataTask_Save::SerializeLevel(const ULevel* Level, const ULevelStreaming
 	const FSELevelFilter& Filter = LevelRecord.Filter;
 
 	LevelRecord.CleanRecords();	   // Empty level record before serializing it
+	LevelRecord.bUseClassPlans = Slot->bUseClassPlans;
 
 	TArray<const AActor*> ActorsToSerialize;
 	for (AActor* Actor : Level->Actors)
@@ -267,20 +262,38 @@ void FSEDataTask_Save::SerializeLevel(const ULevel* Level, const ULevelStreaming
 		}
 	}
 	LevelRecord.Actors.SetNum(ActorsToSerialize.Num());
+	for (int32 i = 0; i < ActorsToSerialize.Num(); ++i)
+	{
+		// References between actors of this level are saved as record indices
+		LevelRecord.Objects.AddRecordObject(i, ActorsToSerialize[i]);
+	}
 
+	// Threads add names and objects to the tables in any order. Indices written by each record are collected
+	// so that the tables can be sorted after
+	TArray<TArray<FSETableFixup>> Fixups;
+	Fixups.SetNum(ActorsToSerialize.Num());
 	ParallelFor(
 		ActorsToSerialize.Num(),
-		[&LevelRecord, &ActorsToSerialize, &Filter](int32 i) {
-			SERecords::SerializeActor(ActorsToSerialize[i], LevelRecord.Actors[i], Filter.ComponentFilter);
+		[&LevelRecord, &ActorsToSerialize, &Filter, &Fixups](int32 i) {
+			FSEArchiveTables Tables = LevelRecord.GetTables();
+			Tables.Fixups = &Fixups[i];
+			SERecords::SerializeActor(
+				ActorsToSerialize[i], LevelRecord.Actors[i], Filter.ComponentFilter, Tables);
 		},
 		Slot->ShouldSerializeAsync() ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+	SERecords::SortTables(LevelRecord.GetTables(), LevelRecord.Actors, Fixups);
 }
 
 void FSEDataTask_Save::SaveFile()
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(FSEDataTask_Save::SaveFile);
-	SaveFileTask =
-		FSEFileHelpers::SaveFile(Manager->GetActiveSlot(), SlotName.ToString(), Slot->bUseCompression);
+	USaveSlot* ActiveSlot = Manager->GetActiveSlot();
+	// Mapped files can't be replaced on some platforms. Detached here since the pipe must not modify records
+	if (USaveSlotData* ActiveData = ActiveSlot->GetData())
+	{
+		ActiveData->DetachMappedRecords();
+	}
+	SaveFileTask = FSEFileHelpers::SaveFile(ActiveSlot, SlotName.ToString(), Slot->bUseCompression);
 
 	if (!Slot->ShouldSaveFileAsync())
 	{
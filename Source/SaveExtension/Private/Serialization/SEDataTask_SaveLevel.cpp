@@ -2,7 +2,9 @@
 
 #include "Serialization/SEDataTask_SaveLevel.h"
 
+#include "SEFileHelpers.h"
 #include "SaveExtension.h"
+#include "SaveSlot.h"
 
 
 /////////////////////////////////////////////////////
@@ -22,6 +24,7 @@ void FSEDataTask_SaveLevel::OnStart()
 		PrepareLevel(StreamingLevel->GetLoadedLevel(), *LevelRecord);
 
 		SerializeLevel(StreamingLevel->GetLoadedLevel(), StreamingLevel);
+		SpillLevels();
 
 		Finish(true);
 		return;
@@ -29,6 +32,61 @@ void FSEDataTask_SaveLevel::OnStart()
 	Finish(false);
 }
 
+void FSEDataTask_SaveLevel::SpillLevels()
+{
+	const int64 MaxSize = int64(Slot->MaxRecordsMemory) * 1024 * 1024;
+	if (MaxSize <= 0)
+	{
+		return;
+	}
+
+	int64 Size = SlotData->RootLevel.GetAllocatedSize();
+	TArray<TPair<int64, FName>> Candidates;
+	for (const FStreamingLevelRecord& Level : SlotData->SubLevels)
+	{
+		if (Level.IsPending())
+		{
+			continue;
+		}
+		const int64 LevelSize = Level.GetAllocatedSize();
+		Size += LevelSize;
+
+		// Records of visible levels are saved again when they are hidden
+		const ULevelStreaming* const* LevelStreaming =
+			GetWorld()->GetStreamingLevels().FindByPredicate([&Level](const ULevelStreaming* Other) {
+				return Level == Other;
+			});
+		if (!LevelStreaming || !(*LevelStreaming)->IsLevelVisible() || *LevelStreaming == StreamingLevel)
+		{
+			Candidates.Emplace(LevelSize, Level.Name);
+		}
+	}
+	if (Size <= MaxSize)
+	{
+		return;
+	}
+
+	// Biggest first, until records fit
+	Candidates.Sort([](const TPair<int64, FName>& A, const TPair<int64, FName>& B) {
+		return A.Key > B.Key;
+	});
+	TArray<FName> LevelNames;
+	for (const TPair<int64, FName>& Candidate : Candidates)
+	{
+		if (Size <= MaxSize)
+		{
+			break;
+		}
+		LevelNames.Add(Candidate.Value);
+		Size -= Candidate.Key;
+	}
+	if (LevelNames.Num() > 0)
+	{
+		SELog(Slot, FString::Printf(TEXT("Spilling records of %i levels"), LevelNames.Num()));
+		FSEFileHelpers::SpillLevels(Slot, LevelNames);
+	}
+}
+
 void FSEDataTask_SaveLevel::OnFinish(bool bSuccess)
 {
 	SELog(Slot, "Finished Serializing level", FColor::Green);
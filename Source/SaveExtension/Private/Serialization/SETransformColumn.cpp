@@ -0,0 +1,354 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#include "Serialization/SETransformColumn.h"
+
+#include <Math/VectorRegister.h>
+
+
+/** Scale of a quantized transform. Most transforms have no scale or a uniform one */
+enum class ESEScaleType : uint8
+{
+	One,
+	Uniform,
+	NonUniform
+};
+
+
+/** Stores values as planes of their bytes, lowest first. High bytes of nearby values are mostly the same */
+static void SerializeBytePlanes(FArchive& Ar, TArray<uint32>& Values, int32 Num, uint8 Bits)
+{
+	const int32 NumPlanes = (Bits + 7) / 8;
+	TArray<uint8> Planes;
+	Planes.SetNumUninitialized(NumPlanes * Num);
+	if (Ar.IsSaving())
+	{
+		for (int32 Plane = 0; Plane < NumPlanes; ++Plane)
+		{
+			uint8* PlaneBytes = Planes.GetData() + Plane * Num;
+			for (int32 i = 0; i < Num; ++i)
+			{
+				PlaneBytes[i] = uint8(Values[i] >> (Plane * 8));
+			}
+		}
+		Ar.Serialize(Planes.GetData(), Planes.Num());
+	}
+	else
+	{
+		Ar.Serialize(Planes.GetData(), Planes.Num());
+		Values.Init(0, Num);
+		for (int32 Plane = 0; Plane < NumPlanes; ++Plane)
+		{
+			const uint8* PlaneBytes = Planes.GetData() + Plane * Num;
+			for (int32 i = 0; i < Num; ++i)
+			{
+				Values[i] |= uint32(PlaneBytes[i]) << (Plane * 8);
+			}
+		}
+	}
+}
+
+/** Truncates to integers clamped to [0, Limit]. Values must be offset by half a step to round them */
+static FORCEINLINE VectorRegister4Int QuantizeVector(
+	const VectorRegister4Float& Value, const VectorRegister4Int& Limit)
+{
+	return VectorIntMin(VectorIntMax(VectorFloatToInt(Value), GlobalVectorConstants::IntZero), Limit);
+}
+
+
+void FSETransformColumn::Serialize(FArchive& Ar)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSETransformColumn::Serialize);
+
+	if (Ar.IsSaving() && PositionBits > 0)
+	{
+		PositionBits = FMath::Min(PositionBits, MaxPositionBits);
+		RotationBits = FMath::Clamp(RotationBits, uint8(1), MaxRotationBits);
+	}
+	Ar << PositionBits;
+	Ar << RotationBits;
+
+	int32 NumTransforms = Transforms.Num();
+	int32 NumVelocities = LinearVelocities.Num();
+	Ar << NumTransforms;
+	Ar << NumVelocities;
+	if (Ar.IsLoading())
+	{
+		if (NumTransforms < 0 || NumVelocities < 0 || PositionBits > MaxPositionBits ||
+			(PositionBits > 0 && (RotationBits == 0 || RotationBits > MaxRotationBits)))
+		{
+			Ar.SetError();
+			return;
+		}
+		Transforms.SetNum(NumTransforms);
+		LinearVelocities.Init(FVector::ZeroVector, NumVelocities);
+		AngularVelocities.Init(FVector::ZeroVector, NumVelocities);
+	}
+	check(LinearVelocities.Num() == AngularVelocities.Num());
+
+	if (PositionBits == 0)
+	{
+		for (FTransform& Transform : Transforms)
+		{
+			Ar << Transform;
+		}
+	}
+	else
+	{
+		SerializeQuantizedTransforms(Ar);
+	}
+	SerializeVelocities(Ar);
+}
+
+void FSETransformColumn::SerializeQuantizedTransforms(FArchive& Ar)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSETransformColumn::SerializeQuantizedTransforms);
+
+	const int32 Num = Transforms.Num();
+	const uint32 MaxPosition = (1u << PositionBits) - 1;
+	const uint32 MaxRotation = (1u << RotationBits) - 1;
+
+	// Positions are stored relative to the bounds of all of them
+	FVector Min = FVector::ZeroVector;
+	FVector Max = FVector::ZeroVector;
+	if (Ar.IsSaving() && Num > 0)
+	{
+		const FVector First = Transforms[0].GetLocation();
+		VectorRegister4Double MinRegister = MakeVectorRegisterDouble(First.X, First.Y, First.Z, 0.0);
+		VectorRegister4Double MaxRegister = MinRegister;
+		for (const FTransform& Transform : Transforms)
+		{
+			const FVector Location = Transform.GetLocation();
+			const VectorRegister4Double Position =
+				MakeVectorRegisterDouble(Location.X, Location.Y, Location.Z, 0.0);
+			MinRegister = VectorMin(MinRegister, Position);
+			MaxRegister = VectorMax(MaxRegister, Position);
+		}
+		double Bounds[4];
+		VectorStore(MinRegister, Bounds);
+		Min = {Bounds[0], Bounds[1], Bounds[2]};
+		VectorStore(MaxRegister, Bounds);
+		Max = {Bounds[0], Bounds[1], Bounds[2]};
+	}
+	Ar << Min;
+	Ar << Max;
+
+	const FVector Step = (Max - Min) / double(MaxPosition);
+	const VectorRegister4Double PositionOffset = MakeVectorRegisterDouble(Min.X, Min.Y, Min.Z, 0.0);
+
+	TArray<uint32> PositionColumns[3];
+	TArray<uint32> RotationColumns[3];
+	TArray<uint8> LargestComponents;
+	TArray<uint8> ScaleTypes;
+	TArray<float> Scales;
+	if (Ar.IsSaving())
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			PositionColumns[Axis].SetNumUninitialized(Num);
+			RotationColumns[Axis].SetNumUninitialized(Num);
+		}
+		LargestComponents.SetNumUninitialized(Num);
+		ScaleTypes.SetNumUninitialized(Num);
+
+		auto Inverse = [](double Value) {
+			return Value > 0.0 ? 1.0 / Value : 0.0;
+		};
+		const VectorRegister4Double PositionScale =
+			MakeVectorRegisterDouble(Inverse(Step.X), Inverse(Step.Y), Inverse(Step.Z), 0.0);
+		const VectorRegister4Int PositionLimit = VectorIntSet1(int32(MaxPosition));
+		const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+		// Components other than the largest are within +-1/sqrt(2). They are mapped to [0, MaxRotation]
+		const VectorRegister4Float RotationScale = VectorSetFloat1(float(MaxRotation) * UE_HALF_SQRT_2);
+		const VectorRegister4Float RotationOffset = VectorSetFloat1(float(MaxRotation) * 0.5f + 0.5f);
+		const VectorRegister4Int RotationLimit = VectorIntSet1(int32(MaxRotation));
+
+		alignas(16) int32 Quantized[4];
+		for (int32 i = 0; i < Num; ++i)
+		{
+			const FTransform& Transform = Transforms[i];
+
+			const FVector Location = Transform.GetLocation();
+			const VectorRegister4Double Relative =
+				VectorSubtract(MakeVectorRegisterDouble(Location.X, Location.Y, Location.Z, 0.0), PositionOffset);
+			const VectorRegister4Float Position =
+				VectorAdd(MakeVectorRegisterFloatFromDouble(VectorMultiply(Relative, PositionScale)), Half);
+			VectorIntStoreAligned(QuantizeVector(Position, PositionLimit), Quantized);
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				PositionColumns[Axis][i] = uint32(Quantized[Axis]);
+			}
+
+			// Smallest three. The largest component is rebuilt from the others, so it must be positive
+			const FQuat Rotation = Transform.GetRotation().GetNormalized();
+			const double Components[4]{Rotation.X, Rotation.Y, Rotation.Z, Rotation.W};
+			int32 Largest = 0;
+			for (int32 k = 1; k < 4; ++k)
+			{
+				if (FMath::Abs(Components[k]) > FMath::Abs(Components[Largest]))
+				{
+					Largest = k;
+				}
+			}
+			const double Sign = Components[Largest] < 0.0 ? -1.0 : 1.0;
+			const VectorRegister4Float RotationRegister = MakeVectorRegisterFloat(float(Components[0] * Sign),
+				float(Components[1] * Sign), float(Components[2] * Sign), float(Components[3] * Sign));
+			VectorIntStoreAligned(QuantizeVector(
+				VectorMultiplyAdd(RotationRegister, RotationScale, RotationOffset), RotationLimit), Quantized);
+			LargestComponents[i] = uint8(Largest);
+			for (int32 k = 0, Column = 0; k < 4; ++k)
+			{
+				if (k != Largest)
+				{
+					RotationColumns[Column++][i] = uint32(Quantized[k]);
+				}
+			}
+
+			const FVector Scale = Transform.GetScale3D();
+			if (Scale == FVector::OneVector)
+			{
+				ScaleTypes[i] = uint8(ESEScaleType::One);
+			}
+			else if (Scale.X == Scale.Y && Scale.Y == Scale.Z)
+			{
+				ScaleTypes[i] = uint8(ESEScaleType::Uniform);
+				Scales.Add(float(Scale.X));
+			}
+			else
+			{
+				ScaleTypes[i] = uint8(ESEScaleType::NonUniform);
+				Scales.Append({float(Scale.X), float(Scale.Y), float(Scale.Z)});
+			}
+		}
+	}
+	else
+	{
+		LargestComponents.SetNumUninitialized(Num);
+		ScaleTypes.SetNumUninitialized(Num);
+	}
+
+	for (TArray<uint32>& Column : PositionColumns)
+	{
+		SerializeBytePlanes(Ar, Column, Num, PositionBits);
+	}
+	Ar.Serialize(LargestComponents.GetData(), Num);
+	for (TArray<uint32>& Column : RotationColumns)
+	{
+		SerializeBytePlanes(Ar, Column, Num, RotationBits);
+	}
+	Ar.Serialize(ScaleTypes.GetData(), Num);
+	Ar << Scales;
+
+	if (!Ar.IsLoading() || Ar.IsError())
+	{
+		return;
+	}
+
+	const VectorRegister4Double PositionStep = MakeVectorRegisterDouble(Step.X, Step.Y, Step.Z, 0.0);
+	const VectorRegister4Float RotationScale = VectorSetFloat1(1.f / (float(MaxRotation) * UE_HALF_SQRT_2));
+	const VectorRegister4Float RotationOffset = VectorSetFloat1(-UE_HALF_SQRT_2);
+
+	double Location[4];
+	alignas(16) float Components[4];
+	int32 ScaleIndex = 0;
+	for (int32 i = 0; i < Num; ++i)
+	{
+		const VectorRegister4Int StoredPosition = MakeVectorRegisterInt(
+			int32(PositionColumns[0][i]), int32(PositionColumns[1][i]), int32(PositionColumns[2][i]), 0);
+		const VectorRegister4Double Position{VectorIntToFloat(StoredPosition)};
+		VectorStore(VectorMultiplyAdd(Position, PositionStep, PositionOffset), Location);
+
+		const int32 Largest = LargestComponents[i];
+		if (Largest > 3)
+		{
+			Ar.SetError();
+			return;
+		}
+		int32 StoredComponents[4]{};
+		for (int32 k = 0, Column = 0; k < 4; ++k)
+		{
+			if (k != Largest)
+			{
+				StoredComponents[k] = int32(RotationColumns[Column++][i]);
+			}
+		}
+		const VectorRegister4Int StoredRotation = MakeVectorRegisterInt(
+			StoredComponents[0], StoredComponents[1], StoredComponents[2], StoredComponents[3]);
+		VectorStoreAligned(
+			VectorMultiplyAdd(VectorIntToFloat(StoredRotation), RotationScale, RotationOffset), Components);
+		Components[Largest] = 0.f;
+		const float SizeSquared = Components[0] * Components[0] + Components[1] * Components[1] +
+								  Components[2] * Components[2] + Components[3] * Components[3];
+		Components[Largest] = FMath::Sqrt(FMath::Max(0.f, 1.f - SizeSquared));
+		FQuat Rotation{Components[0], Components[1], Components[2], Components[3]};
+		Rotation.Normalize();
+
+		FVector Scale = FVector::OneVector;
+		switch (ESEScaleType(ScaleTypes[i]))
+		{
+			case ESEScaleType::One:
+				break;
+			case ESEScaleType::Uniform:
+				if (!Scales.IsValidIndex(ScaleIndex))
+				{
+					Ar.SetError();
+					return;
+				}
+				Scale = FVector{Scales[ScaleIndex++]};
+				break;
+			case ESEScaleType::NonUniform:
+				if (!Scales.IsValidIndex(ScaleIndex + 2))
+				{
+					Ar.SetError();
+					return;
+				}
+				Scale = {Scales[ScaleIndex], Scales[ScaleIndex + 1], Scales[ScaleIndex + 2]};
+				ScaleIndex += 3;
+				break;
+			default:
+				Ar.SetError();
+				return;
+		}
+
+		Transforms[i] = FTransform{Rotation, FVector{Location[0], Location[1], Location[2]}, Scale};
+	}
+}
+
+void FSETransformColumn::SerializeVelocities(FArchive& Ar)
+{
+	// Most actors are not moving. Only velocities of those that are get stored
+	TBitArray<> Moving;
+	if (Ar.IsSaving())
+	{
+		Moving.Init(false, LinearVelocities.Num());
+		for (int32 i = 0; i < LinearVelocities.Num(); ++i)
+		{
+			Moving[i] = !LinearVelocities[i].IsNearlyZero() || !AngularVelocities[i].IsNearlyZero();
+		}
+	}
+	Ar << Moving;
+	if (Ar.IsLoading() && Moving.Num() != LinearVelocities.Num())
+	{
+		Ar.SetError();
+		return;
+	}
+
+	for (TConstSetBitIterator<> It(Moving); It && !Ar.IsError(); ++It)
+	{
+		FVector& Linear = LinearVelocities[It.GetIndex()];
+		FVector& Angular = AngularVelocities[It.GetIndex()];
+		if (PositionBits == 0)
+		{
+			Ar << Linear;
+			Ar << Angular;
+			continue;
+		}
+
+		// Quantized transforms store velocities in single precision
+		FVector3f Linear3f{Linear};
+		FVector3f Angular3f{Angular};
+		Ar << Linear3f;
+		Ar << Angular3f;
+		Linear = FVector{Linear3f};
+		Angular = FVector{Angular3f};
+	}
+}
@@ -0,0 +1,66 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Engine/DataAsset.h>
+
+#include "SECompressionDictionary.generated.h"
+
+
+/**
+ * Compression dictionary trained from existing save files. Small chunks, like the records of a streaming
+ * level, have too little data for a codec to find repetitions in. Compressing them with the content common
+ * to all saves as history makes them several times smaller and faster to compress.
+ *
+ * Files store the id of the dictionary their chunks were compressed with, so the same asset (or one with
+ * identical bytes) must be loaded to read them. Retraining it creates a new id.
+ */
+UCLASS(BlueprintType, ClassGroup = SaveExtension)
+class SAVEEXTENSION_API USECompressionDictionary : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Size of the history of zlib. Bigger dictionaries can't be referenced */
+	static constexpr int32 MaxSize = 32 * 1024;
+
+protected:
+	UPROPERTY(VisibleAnywhere, Category = "Dictionary")
+	int32 Id = 0;
+
+	UPROPERTY()
+	TArray<uint8> Bytes;
+
+	/** Level records of at most this many bytes (in MB) are read from each file when training */
+	UPROPERTY(EditAnywhere, Category = "Dictionary", meta = (ClampMin = "1"))
+	int32 MaxSampleSize = 64;
+
+
+public:
+	virtual void PostLoad() override;
+
+	/** Trains the dictionary from the level records of all save files found in the save folder */
+	UFUNCTION(CallInEditor, Category = "Dictionary")
+	void TrainFromSaveFolder();
+
+	/** Replaces the bytes of the dictionary with the content most repeated between samples
+	 * @return false if the samples had nothing in common
+	 */
+	bool Train(TConstArrayView<TArray<uint8>> Samples);
+
+	uint32 GetId() const
+	{
+		return uint32(Id);
+	}
+	TConstArrayView<uint8> GetBytes() const
+	{
+		return Bytes;
+	}
+
+	/** Makes the dictionary available to compress and decompress files by its id */
+	void Register() const;
+
+	/** @return bytes of a registered dictionary. Safe to use from any thread */
+	static TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> Find(uint32 DictionaryId);
+};
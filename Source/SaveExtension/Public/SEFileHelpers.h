@@ -3,6 +3,8 @@
 #pragma once
 
 #include <Containers/StringView.h>
+#include <IO/IoHash.h>
+#include <Misc/AES.h>
 #include <Misc/EngineVersion.h>
 #include <PlatformFeatures.h>
 #include <Serialization/CustomVersion.h>
@@ -15,12 +17,20 @@ class USaveSlot;
 class USaveSlotData;
 class FMemoryReader;
 class FMemoryWriter;
+struct FSERecordBuffer;
+struct FLevelRecord;
+enum class ESEFileDurability : uint8;
+enum class ESECompressionCodec : uint8;
+enum class ESECompressionLevel : uint8;
 
+/** Fills the key save files are encrypted with. Returns false if there is none. Called from any thread */
+DECLARE_DELEGATE_RetVal_OneParam(bool, FSEGetEncryptionKey, FAES::FAESKey& /* OutKey */);
 
 struct FScopedFileWriter
 {
 private:
 	FArchive* Writer = nullptr;
+	FString Filename;
 
 public:
 	FScopedFileWriter(FStringView Filename, int32 Flags = 0);
@@ -29,6 +39,11 @@ public:
 		delete Writer;
 	}
 
+	/** Closes the file after flushing it as requested
+	 * @return true if all data was written
+	 */
+	bool Close(ESEFileDurability Durability);
+
 	FArchive& GetArchive()
 	{
 		return *Writer;
@@ -49,6 +64,7 @@ struct FScopedFileReader
 private:
 	FScopedLoadingState ScopedLoadingState;
 	FArchive* Reader = nullptr;
+	FString Filename;
 
 public:
 	FScopedFileReader(FStringView Filename, int32 Flags = 0);
@@ -65,6 +81,93 @@ public:
 	{
 		return Reader != nullptr;
 	}
+	const FString& GetFilename() const
+	{
+		return Filename;
+	}
+};
+
+
+enum class ESaveFileChunkType : uint8
+{
+	None,
+	// Properties of the slot data object
+	Data,
+	GameInstance,
+	// Not written anymore. Ignored when loading
+	Subsystems,
+	// Records of a persistent or streaming level. Named after the level
+	Level,
+	// Encoded image of the slot. Only read when requested
+	Thumbnail
+};
+
+
+/** Entry of the table of contents of a save file.
+ * Each chunk is compressed independently so that it can be read without the rest of the file.
+ * Compressed chunks are stored as a sequence of blocks (see FSEBlockWriter).
+ */
+struct FSaveFileChunk
+{
+	ESaveFileChunkType Type = ESaveFileChunkType::None;
+	FString Name;
+	bool bCompressed = false;
+	ESECompressionCodec Codec{};
+	// Position and size of the chunk in the file
+	int64 Offset = 0;
+	int64 Size = 0;
+	// Size of the chunk once decompressed
+	int64 RawSize = 0;
+	// File version the chunk was written with. Chunks copied from older files keep their format
+	int32 Version = 0;
+	// Checksum of the stored bytes. 0 if the file was saved without checksums
+	uint64 Hash = 0;
+	// If true, the chunk only stores the blocks that changed since the same chunk of the delta base.
+	// It is rebuilt when read, and Hash is the checksum of the rebuilt bytes
+	bool bDelta = false;
+	// Hash of the stored bytes if the chunk is in the blob store shared by all slots. Zero otherwise
+	FIoHash BlobHash;
+	// Id of the dictionary the chunk was compressed with (see USECompressionDictionary). 0 if none
+	uint32 DictionaryId = 0;
+	// If true, the blocks of the chunk are encrypted with the key of the project
+	bool bEncrypted = false;
+	// If false, encrypted blocks were saved by an older version without counters and tags (see FSEBlockWriter).
+	// They are still read
+	bool bAuthenticated = true;
+	// Checksum of the bytes before compression. Lets journals skip unchanged chunks without compressing them.
+	// 0 if unknown
+	uint64 RawHash = 0;
+
+	// Not serialized in the table. Stored bytes of the chunk, compressed if bCompressed is true
+	TArray64<uint8> Bytes;
+	// Not serialized in the table. If set, the chunk is streamed into the file by it while writing
+	TFunction<void(FArchive&)> Serializer;
+	// Not serialized in the table. File containing the chunk if it is not the one the table was read from
+	FString SourceFile;
+	// Not serialized in the table. File a delta chunk is rebuilt from
+	FString DeltaBaseFile;
+
+
+	bool IsLoaded() const
+	{
+		return Bytes.Num() > 0 || Size == 0;
+	}
+	bool IsStreamingLevel() const;
+	/** @return true if the chunk is only a reference to the blob store */
+	bool IsInBlobStore() const
+	{
+		return !BlobHash.IsZero() && Bytes.IsEmpty() && !Serializer;
+	}
+	bool Decompress(TArray64<uint8>& OutBytes) const;
+	/** Decompresses the chunk from an archive positioned at its stored bytes
+	 * @param OutStoredHash if set, receives the checksum of the stored bytes that were read
+	 */
+	bool Decompress(FArchive& StoredAr, TArray64<uint8>& OutBytes, uint64* OutStoredHash = nullptr) const;
+	/** @return true if the stored bytes match the checksum of the chunk */
+	bool Verify(TConstArrayView64<uint8> StoredBytes) const;
+
+	/** Serializes the entry of this chunk in the table of contents */
+	void Serialize(FArchive& Ar, int32 SaveGameFileVersion);
 };
 
 
@@ -80,22 +183,121 @@ struct FSaveFile
 
 	FString ClassName;
 	TArray<uint8> Bytes;
+	// Copied from the slot stats so that slots can be sorted without deserializing them
+	FDateTime SaveDate;
 
 	FString DataClassName;
 	bool bIsDataCompressed = false;
+	// Codec used for new chunks. Copied chunks keep the codec they were saved with
+	ESECompressionCodec CompressionCodec{};
+	ESECompressionLevel CompressionLevel{};
+	// Dictionary new streaming level chunks are compressed with. 0 if none
+	uint32 CompressionDictionaryId = 0;
+	// Not serialized. Key new chunks are encrypted with, if any
+	TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> EncryptionKey;
+	// Whether new level chunks store their actors grouped by class
+	bool bGroupRecordsByClass = false;
+	// Bits of position and rotation components of grouped transforms. 0 stores them without loss
+	uint8 TransformPositionBits = 0;
+	uint8 TransformRotationBits = 0;
+	// Only used by files saved before data was split in chunks
 	TArray<uint8> DataBytes;
 
+	// Table of contents. Data of the slot split in independent chunks
+	TArray<FSaveFileChunk> Chunks;
+
+	// Checksum of everything before the table offset: header, slot info and data class
+	uint64 HeaderHash = 0;
+	// Checksum of the table of contents. Identifies the file a journal was appended to
+	uint64 TableHash = 0;
+	// Bytes of the journal that were applied over the file while reading. 0 if it has none
+	int64 JournalSize = 0;
+	// Name of the previous version of the file, in the same folder, that delta chunks are rebuilt from
+	FString DeltaBaseName;
+	// Number of files delta chunks depend on. 0 if the file is complete
+	int32 DeltaDepth = 0;
+	// Set while reading if a checksum did not match
+	bool bCorrupted = false;
+
 
 	FSaveFile();
 
 	void Empty();
 	bool IsEmpty() const;
+	bool IsChunked() const;
 
+	/** Reads the header, slot info and table of contents. If the file has a journal, its last complete entry
+	 * replaces them.
+	 * If data is not skipped, it also reads all chunks except levels and the thumbnail, which are left on disk
+	 * until they are needed (see FSEFileHelpers::LoadLevels and USaveSlot::LoadThumbnail).
+	 */
 	void Read(FScopedFileReader& Reader, bool bSkipData);
-	void Write(FScopedFileWriter& Writer, bool bCompressData);
+	/** Reads the stored bytes of a chunk. Delta chunks are rebuilt from their base
+	 * @param bVerify whether to check its checksum
+	 */
+	static bool ReadChunk(FScopedFileReader& Reader, FSaveFileChunk& Chunk, bool bVerify = true);
+	/** Writes the header, all chunks and the table of contents.
+	 * If a base is provided, chunks are stored as the blocks that changed since it was written. DeltaBaseName
+	 * must be set to the name the base will be renamed to.
+	 * @param Base previous version of the file, read from BaseReader
+	 */
+	void Write(FScopedFileWriter& Writer, FScopedFileReader* BaseReader = nullptr, const FSaveFile* Base = nullptr);
+	/** Appends an entry to the journal of a file. Only chunks that changed since Base was saved are written,
+	 * the others keep pointing to where they already are. Chunks are serialized and compared before they are
+	 * compressed, so unchanged chunks are never compressed.
+	 * @param Base file and journal as they were last read or written
+	 */
+	bool WriteJournal(FStringView JournalPath, const FSaveFile& Base, ESEFileDurability Durability);
+	/** Moves level chunks into the blob store shared by all slots. Blobs already stored are not written again
+	 * and the chunks only reference them.
+	 */
+	bool StoreBlobs(ESEFileDurability Durability);
 
 	void SerializeInfo(USaveSlot* Slot);
-	void SerializeData(USaveSlotData* SlotData);
+	/** Encodes the thumbnail of a slot. If it was never loaded, it is copied from the slot's file */
+	void SerializeThumbnail(USaveSlot* Slot);
+	/** Prepares the chunks of a slot data object.
+	 * Records are not serialized here but streamed into the file during Write, one block at a time.
+	 * SlotData must not be modified until the file is written.
+	 */
+	void SerializeData(USaveSlotData* SlotData, bool bCompressData);
+	/** Prepares the chunk of a single level, streamed into the file during Write like the levels of a slot.
+	 * Level must not be modified until the file is written.
+	 */
+	void SerializeLevel(FLevelRecord& Level, bool bCompressData)
+	{
+		AddLevelChunk(Level, bCompressData);
+	}
+
+	/** Applies all loaded chunks to a slot data object. The persistent level is decompressed from the file
+	 * into the memory its records point into, without reading its stored bytes first.
+	 * @param FilePath file this save was read from. Streaming levels not loaded will be read from it later.
+	 * @return false if the records of the persistent level could not be read
+	 */
+	bool DeserializeData(USaveSlotData* SlotData, FStringView FilePath);
+
+	/** Loads the records of a level chunk into memory that its records can point into.
+	 * Uncompressed chunks are mapped from the file when the platform allows it, otherwise they are read.
+	 * Compressed chunks are decompressed from the file as their blocks are read.
+	 */
+	static TSharedPtr<FSERecordBuffer, ESPMode::ThreadSafe> LoadRecordBuffer(
+		FStringView FilePath, FSaveFileChunk& Chunk);
+
+	FSaveFileChunk* FindChunk(ESaveFileChunkType Type, FStringView Name = {});
+	const FSaveFileChunk* FindChunk(ESaveFileChunkType Type, FStringView Name = {}) const;
+
+private:
+	void SerializeTable(FArchive& Ar);
+	bool ReadVerifiedTable(FArchive& Ar, int64 TocOffset);
+	bool VerifyHeader(FArchive& Ar, int64 HeaderSize);
+	void ReadJournal(const FString& JournalPath);
+	void SerializeJournalTable(FArchive& Ar, uint64& BaseTableHash, const FString& JournalPath);
+	void AddChunk(ESaveFileChunkType Type, FString Name, TFunction<void(FArchive&)> Serializer,
+		bool bCompressData);
+	void AddLevelChunk(FLevelRecord& Level, bool bCompressData);
+	void WriteChunk(FArchive& Ar, FSaveFileChunk& Chunk);
+	void WriteDeltaChunk(FArchive& Ar, FSaveFileChunk& Chunk, FScopedFileReader& BaseReader, const FSaveFile& Base);
+	bool CopyChunk(ESaveFileChunkType Type, const FString& Name, FStringView SourceFilePath);
 };
 
 
@@ -103,24 +305,93 @@ struct FSaveFile
 class SAVEEXTENSION_API FSEFileHelpers
 {
 public:
+	/** Writes a slot into a temporary file and renames it over the previous one once complete.
+	 * The file is flushed before renaming according to the slot's FileDurability.
+	 * Slots using a journal append the chunks that changed to it instead, while it is small enough.
+	 * Records mapped from the previous file must be detached first (USaveSlotData::DetachMappedRecords).
+	 */
 	static bool SaveFileSync(USaveSlot* Slot, FStringView OverrideSlotName = {}, const bool bUseCompression = true);
 	static UE::Tasks::TTask<bool> SaveFile(USaveSlot* Slot, FString OverrideSlotName = {}, const bool bUseCompression = true);
 
+	/** Writes the file of a slot again with the last entry of its journal, then discards the journal.
+	 * Chunks are copied as they are stored, without serializing or compressing them again.
+	 * Must run in the pipe so that it doesn't race with a save in progress.
+	 * @return true if the journal was merged into the file
+	 */
+	static bool CompactJournalSync(FStringView SlotName, ESEFileDurability Durability);
+	/** Launches CompactJournalSync in the pipe with low priority, after any save in progress */
+	static UE::Tasks::TTask<bool> CompactJournal(FString SlotName, ESEFileDurability Durability);
+
 	static USaveSlot* LoadFileSync(FStringView SlotName, USaveSlot* SlotHint, bool bLoadData, const USaveManager* Manager);
+	/** Loads a slot in the pipe, recovering it first if a save of it was interrupted */
 	static UE::Tasks::TTask<USaveSlot*> LoadFile(FString SlotName, USaveSlot* SlotHint, bool bLoadData, const USaveManager* Manager);
 
-	static bool DeleteFile(FStringView SlotName);
+	/** Deletes all files of a slot
+	 * @param bCollectBlobs whether to delete blobs that are not referenced by any slot anymore. They are
+	 * collected later in the pipe
+	 */
+	static bool DeleteFile(FStringView SlotName, bool bCollectBlobs = true);
 	static bool FileExists(FStringView SlotName);
 
 	static const FString& GetSaveFolder();
 	static FString GetSlotPath(FStringView SlotName);
+	static FString GetTempSlotPath(FStringView SlotName);
+	static FString GetJournalSlotPath(FStringView SlotName);
+	static FString GetBlobPath(const FIoHash& Hash);
+	/** @return folder of the spill files of this process */
+	static const FString& GetSpillFolder();
+
+	/** Projects bind it to provide the key of slots with bEncryptFiles */
+	static FSEGetEncryptionKey& GetEncryptionKeyDelegate();
+	/** @return key files are encrypted with, or null if the project doesn't provide a valid one */
+	static TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> GetEncryptionKey();
+
+	/** Reads the encoded thumbnail of a slot */
+	static bool LoadThumbnailSync(FStringView SlotName, TArray<uint8>& OutBytes);
+
+	/** Reads the records of streaming levels that were left on disk when their slot was loaded */
+	static bool LoadLevelsSync(USaveSlotData* SlotData, TArrayView<const FName> LevelNames);
+	static UE::Tasks::TTask<bool> LoadLevels(USaveSlotData* SlotData, TArray<FName> LevelNames);
+
+	/** Moves the records of streaming levels out of memory into spill files, to bound the memory used by
+	 * records of levels that are not loaded. They are read back by LoadLevels like records never read, and
+	 * saving a slot copies them from their spill file.
+	 * Must be called from the game thread. Records are kept in memory if their file can't be written.
+	 */
+	static UE::Tasks::TTask<bool> SpillLevels(USaveSlot* Slot, TArrayView<const FName> LevelNames);
 
 	static UObject* DeserializeObject(
 		UObject* Hint, FStringView ClassName, const UObject* Outer, const TArray<uint8>& Bytes);
+	static UObject* FindOrCreateObject(UObject* Hint, FStringView ClassName, const UObject* Outer);
 
 
 	static void FindAllFilesSync(TArray<FString>& FoundSlots);
 
+	/** Restores the temporary file of a slot if a crash happened while replacing the slot with it.
+	 * Must run in the pipe so that it doesn't race with a save in progress.
+	 * @return true if the slot was recovered
+	 */
+	static bool RecoverFileSync(FStringView SlotName);
+
+	/** Restores the temporary files of several slots. Runs in the pipe, waiting for it if called from
+	 * outside. Never call it while listing the save folder, since it moves and deletes files in it.
+	 * @return slots that were recovered
+	 */
+	static TArray<FString> RecoverFilesSync(TArray<FString> SlotNames);
+
+	/** Deletes all blobs that are not referenced by a file in the save folder.
+	 * Must run in the pipe so that it doesn't race with a save in progress.
+	 * @return number of blobs deleted
+	 */
+	static int32 CollectBlobsSync();
+	/** Launches CollectBlobsSync in the pipe, after any save in progress */
+	static UE::Tasks::TTask<int32> CollectBlobs();
+
+	/** Reads a file and verifies the checksums of its header, table of contents and all its chunks
+	 * @return true if the file is not corrupted. Files saved without checksums are always valid.
+	 */
+	static bool VerifyFileSync(FStringView FilePath);
+
 	// @return the pipe used for save file operations
 	static class UE::Tasks::FPipe& GetPipe();
 };
@@ -0,0 +1,170 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <GenericPlatform/GenericPlatformFile.h>
+#include <HAL/CriticalSection.h>
+#include <Misc/DateTime.h>
+
+
+/** Location of a file inside a pack */
+struct FSEPackEntry
+{
+	int64 Offset = 0;
+	int64 Size = 0;
+	FDateTime ModificationTime;
+	/** Space reserved after the file for appends during this session. Not stored */
+	int64 Capacity = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FSEPackEntry& Entry)
+	{
+		Ar << Entry.Offset;
+		Ar << Entry.Size;
+		Ar << Entry.ModificationTime;
+		return Ar;
+	}
+};
+
+
+/**
+ * Platform file layer that keeps all files of a folder inside a single container, for platforms and storage
+ * where creating, renaming and listing files is expensive. Other paths are forwarded to the lower level.
+ * When enabled in the settings, it is mounted over the save folder and everything above it (saving, loading,
+ * deleting and listing slots, journals, blobs and the catalog) works as it does with loose files.
+ *
+ * The container has an allocation table of its files. Files being written go straight into space reserved for
+ * them, which grows as they do, and are committed to the table once flushed or closed. Replacing a file never
+ * writes over its previous version, which stays valid until then. Appended files are extended in place when
+ * the space after them is free. Space of deleted or replaced files is reused, and compacted in the background
+ * once too much of the container is free. Files in the pack can't be memory mapped, so they are read instead.
+ */
+class SAVEEXTENSION_API FSEPackPlatformFile : public IPlatformFile
+{
+	friend class FSEPackReadHandle;
+	friend class FSEPackWriteHandle;
+
+	IPlatformFile* LowerLevel = nullptr;
+	FString PackPath;
+	// Full path of the folder stored in the pack, ending with '/'
+	FString Folder;
+	TUniquePtr<IFileHandle> PackHandle;
+
+	// Files by their path relative to Folder
+	TMap<FString, FSEPackEntry> Entries;
+	int64 TableOffset = 0;
+	int64 TableSize = 0;
+	// Open read handles by the offset of the file they read
+	TMap<int64, int32> Readers;
+	// Extents of deleted or replaced files. Freed once a table without them is committed and their last
+	// reader closes
+	TMap<int64, int64> RetiredExtents;
+	// Space reserved by files being written, by its offset
+	TMap<int64, int64> OpenExtents;
+	bool bDefragmentQueued = false;
+
+	mutable FCriticalSection Lock;
+
+
+public:
+	static const TCHAR* GetTypeName()
+	{
+		return TEXT("SaveExtensionPack");
+	}
+
+	/** @param InFolder folder whose files are stored in the pack at InPackPath */
+	FSEPackPlatformFile(FString InPackPath, FString InFolder);
+	virtual ~FSEPackPlatformFile() override;
+
+	/** Puts a pack of the save folder on top of the platform file chain. Files already in the folder are moved
+	 * into it the first time.
+	 */
+	static bool Mount();
+	static void Unmount();
+	/** @return the mounted pack, if any */
+	static FSEPackPlatformFile* Get();
+
+	/** Moves files towards the start of the container and truncates the free space left at the end
+	 * @return bytes reclaimed
+	 */
+	int64 Defragment();
+	/** @return bytes of the container not used by any file */
+	int64 GetFreeSpace() const;
+	int64 GetPackSize() const;
+
+	// IPlatformFile interface
+	virtual bool ShouldBeUsed(IPlatformFile* Inner, const TCHAR* CmdLine) const override
+	{
+		return false;
+	}
+	virtual bool Initialize(IPlatformFile* Inner, const TCHAR* CmdLine) override;
+	virtual IPlatformFile* GetLowerLevel() override
+	{
+		return LowerLevel;
+	}
+	virtual void SetLowerLevel(IPlatformFile* NewLowerLevel) override
+	{
+		LowerLevel = NewLowerLevel;
+	}
+	virtual const TCHAR* GetName() const override
+	{
+		return GetTypeName();
+	}
+	virtual bool FileExists(const TCHAR* Filename) override;
+	virtual int64 FileSize(const TCHAR* Filename) override;
+	virtual bool DeleteFile(const TCHAR* Filename) override;
+	virtual bool IsReadOnly(const TCHAR* Filename) override;
+	virtual bool MoveFile(const TCHAR* To, const TCHAR* From) override;
+	virtual bool SetReadOnly(const TCHAR* Filename, bool bNewReadOnlyValue) override;
+	virtual FDateTime GetTimeStamp(const TCHAR* Filename) override;
+	virtual void SetTimeStamp(const TCHAR* Filename, FDateTime DateTime) override;
+	virtual FDateTime GetAccessTimeStamp(const TCHAR* Filename) override;
+	virtual FString GetFilenameOnDisk(const TCHAR* Filename) override;
+	virtual IFileHandle* OpenRead(const TCHAR* Filename, bool bAllowWrite = false) override;
+	virtual IFileHandle* OpenWrite(const TCHAR* Filename, bool bAppend = false, bool bAllowRead = false) override;
+	virtual IMappedFileHandle* OpenMapped(const TCHAR* Filename) override;
+	virtual bool DirectoryExists(const TCHAR* Directory) override;
+	virtual bool CreateDirectory(const TCHAR* Directory) override;
+	virtual bool DeleteDirectory(const TCHAR* Directory) override;
+	virtual FFileStatData GetStatData(const TCHAR* FilenameOrDirectory) override;
+	using IPlatformFile::IterateDirectory;
+	using IPlatformFile::IterateDirectoryStat;
+	virtual bool IterateDirectory(const TCHAR* Directory, FDirectoryVisitor& Visitor) override;
+	virtual bool IterateDirectoryStat(const TCHAR* Directory, FDirectoryStatVisitor& Visitor) override;
+
+private:
+	/** @return true if Path is inside the folder of the pack. OutName is relative to it */
+	bool GetPackName(const TCHAR* Path, FString& OutName) const;
+
+	bool ReadHeader();
+	/** Writes the table to free space, then points the header to it */
+	bool CommitTable();
+	/** @return offset of the first free space of at least Size bytes */
+	int64 Allocate(int64 Size) const;
+	/** @return extents of all files, retired files, files being written and the table sorted by offset */
+	TArray<TPair<int64, int64>> GetUsedExtents() const;
+	void ReserveExtent(int64 Offset, int64 Capacity);
+	void UnreserveExtent(int64 Offset);
+	/** Makes room for NeededSize bytes in the extent of a file being written, in place if the space after it is
+	 * free and bMove is false. Otherwise the first Size bytes are copied to a new extent.
+	 * Offset is INDEX_NONE for files that have no extent yet
+	 */
+	bool GrowExtent(int64& Offset, int64& Capacity, int64 Size, int64 NeededSize, bool bMove);
+	/** Points the table to a file written at Offset, replacing any previous version */
+	bool CommitFile(const FString& Name, int64 Offset, int64 Size, int64 Capacity);
+	bool ReadAt(int64 Offset, uint8* Destination, int64 Size);
+	bool WriteAt(int64 Offset, const uint8* Source, int64 Size);
+	bool CopyExtent(int64 From, int64 To, int64 Size);
+	bool FlushPack(bool bFullFlush);
+	/** Called once a file stops being referenced by the table in memory. Its extent stays reserved until the
+	 * header points to a table without it
+	 */
+	void ReleaseExtent(const FSEPackEntry& Entry);
+	void CloseReader(int64 Offset);
+	/** Moves loose files of the folder into the pack */
+	void ImportFolder();
+	void QueueDefragment();
+	/** Adds the files and subdirectories directly inside a directory of the pack */
+	void GetDirectoryContents(
+		const FString& Directory, TArray<TPair<FString, FFileStatData>>& OutContents) const;
+};
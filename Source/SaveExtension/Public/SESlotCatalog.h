@@ -0,0 +1,80 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <HAL/CriticalSection.h>
+#include <Misc/DateTime.h>
+#include <Misc/Optional.h>
+
+
+struct FSaveFile;
+
+
+/** Summary of a save file kept by the slot catalog */
+struct FSESlotCatalogEntry
+{
+	FString Name;
+	FString ClassName;
+	// Serialized slot info. Display name, map, stats, etc
+	TArray<uint8> InfoBytes;
+	int64 FileSize = 0;
+	FDateTime ModificationTime;
+	// Size of the journal of the slot. 0 if it has none
+	int64 JournalSize = 0;
+	// Date stored in the slot stats. Modification time for files saved before it was stored
+	FDateTime SaveDate;
+	// Location of the thumbnail in the file. Size is 0 if there is none, offset is 0 if it is in the journal
+	int64 ThumbnailOffset = 0;
+	int64 ThumbnailSize = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FSESlotCatalogEntry& Entry);
+};
+
+
+/**
+ * Index of all save files.
+ * Slot infos are kept in memory and in a small file in the save folder so that listing slots doesn't need to
+ * open every file. Entries are validated against the size and modification time of their files, and the
+ * size of their journals.
+ */
+class SAVEEXTENSION_API FSESlotCatalog
+{
+	mutable FCriticalSection Lock;
+	TMap<FString, FSESlotCatalogEntry> Entries;
+	// True once the index file has been read
+	bool bLoaded = false;
+	// True once entries have been validated against the save folder
+	bool bRefreshed = false;
+
+
+public:
+	static FSESlotCatalog& Get();
+
+	/** Validates the catalog against the save folder.
+	 * Only files that changed since they were indexed are opened, and they are read in parallel.
+	 */
+	void Refresh();
+
+	/** Refreshes the catalog and returns all its entries
+	 * @param bSortByRecent sort entries by save date instead of by name
+	 */
+	void GetEntries(TArray<FSESlotCatalogEntry>& OutEntries, bool bSortByRecent = false);
+
+	/** @return if the slot exists, or nothing if the catalog was never refreshed */
+	TOptional<bool> Contains(FStringView SlotName) const;
+
+	/** @return true if the thumbnail of the slot is known */
+	bool FindThumbnail(FStringView SlotName, int64& OutOffset, int64& OutSize) const;
+
+	void Update(FStringView SlotName, const FSaveFile& File);
+	void Remove(FStringView SlotName);
+
+	static FString GetIndexPath();
+
+private:
+	void LoadIndex();
+	void SaveIndex() const;
+	static bool ReadEntry(FSESlotCatalogEntry& Entry);
+	static void FillEntry(FSESlotCatalogEntry& Entry, const FSaveFile& File);
+};
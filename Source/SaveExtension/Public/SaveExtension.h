@@ -13,8 +13,8 @@ DECLARE_LOG_CATEGORY_EXTERN(LogSaveExtension, All, All);
 class FSaveExtension : public IModuleInterface
 {
 public:
-	void StartupModule() override {}
-	void ShutdownModule() override {}
+	void StartupModule() override;
+	void ShutdownModule() override;
 	bool SupportsDynamicReloading() override
 	{
 		return true;
@@ -25,4 +25,9 @@ public:
 	// may be interrupted if the game is paused.
 	UPROPERTY(EditAnywhere, Category = "Save Extension", Config)
 	bool bTickWithGameWorld = false;
+
+	// If true, all files of the save folder are kept inside a single pack file instead of one file each.
+	// Useful on platforms where creating and listing files is slow. Loose files are moved into it on startup.
+	UPROPERTY(EditAnywhere, Category = "Save Extension", Config, meta = (ConfigRestartRequired = true))
+	bool bUsePackFile = false;
 };
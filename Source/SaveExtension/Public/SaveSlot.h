@@ -15,9 +15,12 @@
 
 struct FSELevelFilter;
 class UTexture2D;
+class USECompressionDictionary;
 
 
 DECLARE_DELEGATE_OneParam(FSEOnThumbnailCaptured, bool);
+DECLARE_DELEGATE_OneParam(FSEOnThumbnailLoaded, UTexture2D*);
+DECLARE_DYNAMIC_DELEGATE_OneParam(FSEOnThumbnailLoadedDynamic, UTexture2D*, Thumbnail);
 
 /**
  * Specifies the behavior while saving or loading
@@ -31,6 +34,46 @@ enum class ESEAsyncMode : uint8
 	SaveAndLoadAsync = LoadAsync | SaveAsync
 };
 
+/**
+ * How much effort is made to get save files into disk before they replace the previous ones
+ */
+UENUM()
+enum class ESEFileDurability : uint8
+{
+	// Files are handed to the OS. A power loss may still lose the last save
+	None,
+	// Buffered data is flushed to the OS before the file replaces the old one
+	Flush,
+	// The OS is asked to write the file to disk. Safest but slowest
+	FullFlush
+};
+
+/**
+ * Codec used to compress save files. Oodle codecs are ordered from fastest to smallest files
+ */
+UENUM()
+enum class ESECompressionCodec : uint8
+{
+	Zlib,
+	LZ4,
+	Selkie,
+	Mermaid,
+	Kraken,
+	Leviathan
+};
+
+/**
+ * Trade between compression speed and ratio. Not used by LZ4
+ */
+UENUM()
+enum class ESECompressionLevel : uint8
+{
+	Fastest,
+	Fast,
+	Normal,
+	Optimal
+};
+
 
 USTRUCT(Blueprintable)
 struct FSaveSlotStats
@@ -108,6 +151,13 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Serialization")
 	bool bStoreSublevels = true;
 
+	/** Once the records of all levels take more memory than this (in MB), records of hidden sub-levels are
+	 * written to disk and read back when their level is shown again. 0 keeps all records in memory.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Serialization",
+		meta = (EditCondition = "bStoreSublevels", ClampMin = "0", UIMin = "0"))
+	int32 MaxRecordsMemory = 0;
+
 	/** If true save files will be compressed
 	 * Performance: Can add from 10ms to 20ms to loading and saving (estimate) but reduce file sizes making
 	 * them up to 30x smaller
@@ -115,6 +165,116 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files")
 	bool bUseCompression = true;
 
+	/** Codec used to compress files. Selkie and LZ4 decompress the fastest, Kraken balances speed and size,
+	 * Leviathan makes the smallest files. Zlib is the slowest on both sides, and the default since it is what
+	 * files were compressed with before codecs could be chosen.
+	 * Files store their codec, so it can be changed at any time.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files", meta = (EditCondition = "bUseCompression"))
+	ESECompressionCodec CompressionCodec = ESECompressionCodec::Zlib;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files", meta = (EditCondition = "bUseCompression"))
+	ESECompressionLevel CompressionLevel = ESECompressionLevel::Fast;
+
+	/** Dictionary streaming levels are compressed with. Small levels compress several times better and
+	 * faster with it. Train it from existing saves (see USECompressionDictionary).
+	 * Files saved with a dictionary need it to be loaded.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files", meta = (EditCondition = "bUseCompression"))
+	TObjectPtr<USECompressionDictionary> CompressionDictionary;
+
+	/** If checked, actors of each level are stored grouped by class, with their headers, transforms, tags
+	 * and data in separate streams. Files compress faster and smaller, and actors are restored in their
+	 * original order when loading.
+	 * Streams are written straight into the file, taking two passes over the records each. Saving only keeps
+	 * the order of the actors (4 bytes each) and, with quantized transforms, a copy of every transform and
+	 * velocity of the level in memory.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files")
+	bool bGroupRecordsByClass = false;
+
+	/** If checked, the data of the slot is encrypted with AES together with its compression, one block at a
+	 * time in parallel. Each block is authenticated, so files saved with another key or modified are not
+	 * loaded. The key is provided by the project (see FSEFileHelpers::GetEncryptionKeyDelegate).
+	 * Slot info and thumbnails are not encrypted so that slots can be listed without it.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files")
+	bool bEncryptFiles = false;
+
+	/** If checked, actors and components of levels store only their SaveGame properties, found once per class,
+	 * instead of calling their Serialize. Faster to save and load, and properties whose type changed are
+	 * skipped. Classes that store extra data by overriding Serialize should leave it unchecked.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files")
+	bool bUseClassPlans = false;
+
+	/** If checked, transforms of grouped records are quantized. Positions are stored relative to the bounds of
+	 * their level, rotations as their three smallest components and uniform scales once.
+	 * Velocities are stored in single precision.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files",
+		meta = (EditCondition = "bGroupRecordsByClass"))
+	bool bQuantizeTransforms = false;
+
+	/** Bits of each position component. Precision is the size of the level divided by 2^Bits:
+	 * 20 bits keep a 10km level under 1cm.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files",
+		meta = (EditCondition = "bGroupRecordsByClass && bQuantizeTransforms", ClampMin = "8", ClampMax = "24"))
+	int32 TransformPositionBits = 20;
+
+	/** Bits of each stored rotation component. 15 bits keep rotations within 0.01 degrees */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files",
+		meta = (EditCondition = "bGroupRecordsByClass && bQuantizeTransforms", ClampMin = "8", ClampMax = "16"))
+	int32 TransformRotationBits = 15;
+
+	/** Files are written next to the slot and renamed over it once complete, so that a crash while saving
+	 * never loses the previous save. Durability controls how much to wait for the disk before renaming.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files")
+	ESEFileDurability FileDurability = ESEFileDurability::Flush;
+
+	/** If checked, files are read back after being written and their checksums verified before they replace
+	 * the previous save. Doubles the cost of writing files.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files", AdvancedDisplay)
+	bool bVerifyAfterSave = false;
+
+	/** If checked, only the first save writes the whole file. Following saves append the chunks that
+	 * changed to a journal next to it, which is read on top of the file when loading.
+	 * Recommended for frequent autosaves of big worlds.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files")
+	bool bUseJournal = false;
+
+	/** Once the journal is bigger than this (in MB), it is merged into the file in the background after the
+	 * save that made it grow, and discarded.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files",
+		meta = (EditCondition = "bUseJournal", ClampMin = "1", UIMin = "1"))
+	int32 MaxJournalSize = 64;
+
+	/** If checked, saves over an existing file only store the blocks that changed since it was written.
+	 * The previous file is kept next to the slot to rebuild the new one when loading.
+	 * Ignored if the slot uses a journal.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files")
+	bool bUseDeltaSaves = false;
+
+	/** Number of consecutive delta saves before the whole file is written again. Longer chains write less
+	 * but take longer to load.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files",
+		meta = (EditCondition = "bUseDeltaSaves", ClampMin = "1", UIMin = "1"))
+	int32 MaxDeltaChain = 4;
+
+	/** If checked, level records are stored once in a folder shared by all slots and files only reference
+	 * them. Slots of the same game share most of their records, so only new records get written.
+	 * Records no slot references are deleted with the last slot using them.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Files")
+	bool bUseBlobStore = false;
+
 	/** Serialization will be multi-threaded between all available cores. */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Async")
 	ESEAsyncMode MultithreadedSerialization = ESEAsyncMode::SaveAndLoadSync;
@@ -173,7 +333,8 @@ public:
 	UPROPERTY(SaveGame, BlueprintReadWrite, Category = SaveSlot)
 	FSaveSlotStats Stats;
 
-	UPROPERTY(BlueprintReadWrite, Transient, Category = SaveSlot)	 // Saved
+	/** Saved in its own section of the file. Not loaded with the slot, see LoadThumbnail */
+	UPROPERTY(BlueprintReadWrite, Transient, Category = SaveSlot)
 	TObjectPtr<UTexture2D> Thumbnail;
 
 protected:
@@ -181,6 +342,11 @@ protected:
 	bool bCapturingThumbnail = false;
 	FSEOnThumbnailCaptured CapturedThumbnailDelegate;
 
+	// True if the file of this slot has a thumbnail that was not loaded
+	bool bThumbnailInFile = false;
+	// Thumbnail of slots saved before it had its own section. Decoded on demand
+	TArray<uint8> LegacyThumbnailBytes;
+
 	UPROPERTY(Transient, BlueprintReadOnly, Category = SaveSlot)
 	TObjectPtr<USaveSlotData> Data;
 
@@ -201,6 +367,38 @@ public:
 		CaptureThumbnail({}, Width, Height);
 	}
 
+	/** Loads the thumbnail of this slot from its file. The image is decoded in the background and the
+	 * texture created on the game thread. Calls back immediately if it was already loaded.
+	 */
+	void LoadThumbnail(FSEOnThumbnailLoaded Callback);
+
+	/** Loads the thumbnail of this slot from its file */
+	UFUNCTION(BlueprintCallable, Category = SaveSlot, meta = (DisplayName = "Load Thumbnail"))
+	void BPLoadThumbnail(FSEOnThumbnailLoadedDynamic Callback)
+	{
+		LoadThumbnail(FSEOnThumbnailLoaded::CreateLambda([Callback](UTexture2D* Texture) {
+			Callback.ExecuteIfBound(Texture);
+		}));
+	}
+
+	/** @return true if the slot has a thumbnail, loaded or not */
+	UFUNCTION(BlueprintPure, Category = SaveSlot)
+	bool HasThumbnail() const;
+
+	// Internal use only recommended
+	void MarkThumbnailInFile(bool bInFile)
+	{
+		bThumbnailInFile = bInFile;
+	}
+	bool IsThumbnailInFile() const
+	{
+		return bThumbnailInFile;
+	}
+	/** Encodes the loaded thumbnail as PNG
+	 * @return false if there is no thumbnail to encode
+	 */
+	bool EncodeThumbnail(TArray<uint8>& OutBytes) const;
+
 	USaveSlotData* GetData() const
 	{
 		return Data;
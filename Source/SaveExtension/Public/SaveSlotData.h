@@ -53,6 +53,14 @@ public:
 	/** Using manual serialization. It's way faster than reflection serialization */
 	virtual void Serialize(FArchive& Ar) override;
 
+	/** Serializes the data of the object that is not stored as records (saved in its own file chunk) */
+	void SerializeProperties(FArchive& Ar);
+
+	FLevelRecord* FindLevelRecord(FName LevelName);
+
+	/** Makes records stop pointing into files mapped while loading, so that those files can be replaced */
+	void DetachMappedRecords();
+
 	UFUNCTION(BlueprintPure, Category = SaveSlotData)
 	FPlayerRecord& FindOrAddPlayerRecord(const FUniqueNetIdRepl& UniqueId);
 	FPlayerRecord* FindPlayerRecord(const FUniqueNetIdRepl& UniqueId);
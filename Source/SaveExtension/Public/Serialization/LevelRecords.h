@@ -5,6 +5,7 @@
 
 #include "LevelFilter.h"
 #include "Records.h"
+#include "SEArchive.h"
 
 #include <CoreMinimal.h>
 #include <Engine/LevelScriptActor.h>
@@ -13,6 +14,29 @@
 #include "LevelRecords.generated.h"
 
 
+/** Tables stored with a level so that its records reference names and objects by index */
+enum class ESELevelTables : uint8
+{
+	// Names and objects are stored as strings by each record
+	None,
+	Names,
+	NamesAndObjects,
+	// Objects saved as records of the level are referenced by record index
+	RecordRefs,
+	// Byte-identical data of records is stored once and referenced by index
+	Payloads,
+	// Records can be grouped by class, with a stream for each of their fields
+	RecordLayouts,
+	// Transforms and velocities of grouped records are stored in a column, optionally quantized
+	TransformColumns,
+	// Streams of grouped records store 64-bit sizes
+	LargeStreams,
+	// Data of records can be serialized with the plan of their class
+	ClassPlans,
+	Latest = ClassPlans
+};
+
+
 /** Represents a level in the world (streaming or persistent) */
 USTRUCT()
 struct FLevelRecord : public FBaseRecord
@@ -31,16 +55,73 @@ struct FLevelRecord : public FBaseRecord
 	/** Not-serialized. During saving or loading points to the live actor */
 	TArray<TPair<FActorRecord*, TWeakObjectPtr<AActor>>> RecordsToActors;
 
+	/** Not-serialized. File containing the records of this level when they have not been read yet */
+	FString PendingFile;
+
+	/** Not-serialized. Memory the loaded records point into */
+	TSharedPtr<FSERecordBuffer, ESPMode::ThreadSafe> Buffer;
+
+	/** Names and objects referenced by index from the records and their data.
+	 * Serialized with SerializeWithTables
+	 */
+	FSENameTable Names;
+	FSEObjectTable Objects;
+
+	/** Not-serialized. Tables used by the records. Older files have less of them, and the data of records
+	 * read from those is saved again in the same format.
+	 */
+	ESELevelTables Tables = ESELevelTables::Latest;
+
+	/** Whether SerializeWithTables stores actors grouped by class, with their headers, transforms, tags and
+	 * data in separate streams. Similar data next to each other compresses better. Assigned before saving,
+	 * loaded from the file.
+	 */
+	bool bGroupByClass = false;
+
+	/** Bits of each position and rotation component of the transforms of grouped records. If 0, they are
+	 * stored without loss. Assigned before saving, loaded from the file.
+	 */
+	uint8 TransformPositionBits = 0;
+	uint8 TransformRotationBits = 0;
+
+	/** Whether the data of records stores only the SaveGame properties found by FSEClassPlan, instead of
+	 * everything UObject::Serialize writes. Assigned before serializing actors, loaded from the file.
+	 */
+	bool bUseClassPlans = false;
+
 	FLevelRecord() : Super() {}
 
 	virtual bool Serialize(FArchive& Ar) override;
 
+	/** Serializes the level as stored in file chunks: its tables first, then records referencing them */
+	bool SerializeWithTables(FArchive& Ar);
+
 	bool IsValid() const
 	{
 		return !Name.IsNone();
 	}
 
+	/** @return true if the records of this level are still on disk and need to be loaded */
+	bool IsPending() const
+	{
+		return !PendingFile.IsEmpty();
+	}
+
 	void CleanRecords();
+
+	/** @return tables to serialize the data of records with */
+	FSEArchiveTables GetTables()
+	{
+		return {Tables >= ESELevelTables::Names ? &Names : nullptr,
+			Tables >= ESELevelTables::NamesAndObjects ? &Objects : nullptr,
+			Tables >= ESELevelTables::ClassPlans && bUseClassPlans};
+	}
+
+	/** Copies the data of records that point into Buffer so that it can be released */
+	void DetachBuffer();
+
+	/** @return bytes of memory held by the records of this level, including the buffer they point into */
+	SIZE_T GetAllocatedSize() const;
 };
 
 
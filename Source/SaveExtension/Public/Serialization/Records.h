@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include "SEArchive.h"
+
+#include <Async/MappedFileHandle.h>
 #include <GameFramework/OnlineReplStructs.h>
 
 #include "Records.generated.h"
@@ -13,6 +16,27 @@ class APlayerState;
 class USubsystem;
 
 
+/** Memory holding the records of a chunk. Either a region mapped from its file or its decompressed bytes.
+ * Records loaded from it keep views into this memory instead of owning copies of their data.
+ */
+struct FSERecordBuffer
+{
+	TArray64<uint8> Bytes;
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+
+	TConstArrayView64<uint8> GetView() const
+	{
+		if (MappedRegion)
+		{
+			return {MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize()};
+		}
+		return Bytes;
+	}
+};
+
+
 USTRUCT()
 struct FBaseRecord
 {
@@ -57,6 +81,8 @@ struct FObjectRecord : public FBaseRecord
 	UClass* Class;
 
 	TArray<uint8> Data;
+	/** Data of a loaded record, pointing into the FSERecordBuffer of its level. Used if Data is empty */
+	TConstArrayView<uint8> DataView;
 	TArray<FName> Tags;
 
 
@@ -64,12 +90,19 @@ struct FObjectRecord : public FBaseRecord
 	FObjectRecord(const UObject* Object);
 
 	virtual bool Serialize(FArchive& Ar) override;
+	/** Serializes only the data of the record */
+	void SerializeData(FArchive& Ar);
 
 	bool IsValid() const
 	{
 		return !Name.IsNone() && Class;
 	}
 
+	TConstArrayView<uint8> GetData() const
+	{
+		return Data.Num() > 0 ? TConstArrayView<uint8>{Data} : DataView;
+	}
+
 	bool operator==(const UObject* Other) const
 	{
 		return Other && Name == Other->GetFName() && Class == Other->GetClass();
@@ -148,8 +181,58 @@ namespace SERecords
 	extern const FName TagNoTags;
 
 
-	void SerializeActor(const AActor* Actor, FActorRecord& Record, const FSEClassFilter& ComponentFilter);
-	bool DeserializeActor(AActor* Actor, const FActorRecord& Record, const FSEClassFilter& ComponentFilter);
+	/** While alive, records loaded on this thread from an archive reading Buffer keep views into it instead
+	 * of copying their data. The archive position must be an offset into Buffer.
+	 */
+	struct SAVEEXTENSION_API FDataViewScope
+	{
+		TConstArrayView64<uint8> Buffer;
+		const FDataViewScope* Previous = nullptr;
+
+		FDataViewScope(TConstArrayView64<uint8> InBuffer);
+		~FDataViewScope();
+
+		static const FDataViewScope* Get();
+	};
+
+
+	/** Data of the records of a level, stored once for each distinct payload.
+	 * While alive, records serialized on this thread store the index of their data in it instead of the data.
+	 */
+	struct SAVEEXTENSION_API FDataTableScope
+	{
+		TArray<TConstArrayView<uint8>> Payloads;
+		/** Payloads read without a FDataViewScope */
+		TArray<TArray<uint8>> Copies;
+		/** Index of the payload of each record being saved, by the address of its data */
+		TMap<const uint8*, int32> Indices;
+		const FDataTableScope* Previous = nullptr;
+
+		FDataTableScope();
+		~FDataTableScope();
+
+		/** Adds the data of the records to save. Byte-identical data is found by hash and stored once */
+		void Add(TConstArrayView<const FObjectRecord*> Records);
+		/** @return index of the payload of a record being saved, or INDEX_NONE if it has no data */
+		int32 Find(TConstArrayView<uint8> Data) const;
+		void Serialize(FArchive& Ar);
+
+		static const FDataTableScope* Get();
+	};
+
+
+	/** @param Tables if set, names and objects in the data of the record are stored as indices into them */
+	void SerializeActor(const AActor* Actor, FActorRecord& Record, const FSEClassFilter& ComponentFilter,
+		FSEArchiveTables Tables = {});
+	bool DeserializeActor(AActor* Actor, const FActorRecord& Record, const FSEClassFilter& ComponentFilter,
+		FSEArchiveTables Tables = {});
+	/** Sorts the tables of a level by the first record using each entry and rewrites the indices in the data
+	 * of the records. Tables filled while records were serialized in parallel then get the same order on
+	 * every save of the same world.
+	 * @param Fixups indices written into the data of each record
+	 */
+	void SortTables(FSEArchiveTables Tables, TArrayView<FActorRecord> Records,
+		TConstArrayView<TArray<FSETableFixup>> Fixups);
 	void SerializePlayer(
 		const APlayerState* PlayerState, FPlayerRecord& Record, const FSEClassFilter& ComponentFilter);
 	void DeserializePlayer(
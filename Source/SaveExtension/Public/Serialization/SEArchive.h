@@ -2,19 +2,143 @@
 #pragma once
 
 #include <CoreMinimal.h>
+#include <Misc/ScopeRWLock.h>
 #include <Serialization/ObjectAndNameAsStringProxyArchive.h>
+#include <UObject/ObjectKey.h>
+
+
+/** Names used by the records of a level.
+ * Records store indices into it so that each name is written and resolved once per file.
+ * Names can be added from multiple threads while actors are serialized.
+ */
+struct SAVEEXTENSION_API FSENameTable
+{
+private:
+	TArray<FName> Names;
+	TMap<FName, int32> Indices;
+	mutable FRWLock Lock;
+
+public:
+	FSENameTable() = default;
+	FSENameTable(const FSENameTable& Other);
+	FSENameTable& operator=(const FSENameTable& Other);
+
+	/** @return index of the name, adding it if needed */
+	int32 Add(FName Name);
+	/** @return the name at Index or None if it is out of bounds */
+	FName Get(int32 Index) const
+	{
+		return Names.IsValidIndex(Index) ? Names[Index] : NAME_None;
+	}
+	bool IsValidIndex(int32 Index) const
+	{
+		return Names.IsValidIndex(Index);
+	}
+	int32 Num() const
+	{
+		return Names.Num();
+	}
+	void Reset();
+	/** Moves each name to NewIndices[Index] */
+	void Remap(TConstArrayView<int32> NewIndices);
+
+	/** Names are stored as strings and all of them are resolved when loaded */
+	void Serialize(FArchive& Ar);
+};
+
+
+/** Classes and other objects referenced by the records of a level.
+ * Records store indices into it so that each path is built once when saving and each object is found or
+ * loaded once when loading.
+ * Actors saved as records of the same level are also stored by record index, so that they are found even
+ * if they were respawned with a different name.
+ */
+struct SAVEEXTENSION_API FSEObjectTable
+{
+private:
+	TArray<FString> Paths;
+	// Record index of each entry, or INDEX_NONE if it is not a record of this level
+	TArray<int32> Records;
+	TMap<FString, int32> PathIndices;
+	// Objects added while saving. Avoids building their path again
+	TMap<FObjectKey, int32> ObjectIndices;
+	// Objects resolved while loading. Filled when first requested, since some may not exist yet
+	TArray<TWeakObjectPtr<UObject>> Objects;
+
+	// Not serialized. Records of the level being saved by object
+	TMap<FObjectKey, int32> RecordIndices;
+	// Not serialized. Objects matched or spawned for each record of the level being loaded
+	TArray<TWeakObjectPtr<UObject>> RecordObjects;
+
+	mutable FRWLock Lock;
+
+public:
+	FSEObjectTable() = default;
+	FSEObjectTable(const FSEObjectTable& Other);
+	FSEObjectTable& operator=(const FSEObjectTable& Other);
+
+	/** @return index of the object, adding it if needed */
+	int32 Add(const UObject* Object);
+	/** Registers the live object of a record, before saving or loading the data of the level */
+	void AddRecordObject(int32 RecordIndex, const UObject* Object);
+	/** @return the object at Index, finding or loading it the first time */
+	UObject* Resolve(int32 Index, bool bLoadIfFindFails);
+	int32 Num() const
+	{
+		return Paths.Num();
+	}
+	void Reset();
+	/** Moves each object to NewIndices[Index] */
+	void Remap(TConstArrayView<int32> NewIndices);
+
+	/** @param bWithRecords whether record indices are stored. Older files don't have them */
+	void Serialize(FArchive& Ar, bool bWithRecords);
+};
+
+
+/** Position of a table index written into the data of a record */
+struct FSETableFixup
+{
+	/** Component record whose data contains the index, or INDEX_NONE for the actor record */
+	int32 Component = INDEX_NONE;
+	int32 Offset = 0;
+	int32 Index = INDEX_NONE;
+	bool bObject = false;
+};
+
+
+/** Tables an archive writes names and objects into. Without them, they are written as strings */
+struct FSEArchiveTables
+{
+	FSENameTable* Names = nullptr;
+	FSEObjectTable* Objects = nullptr;
+	/** Whether the data of records is serialized with the plan of their class (see FSEClassPlan) */
+	bool bClassPlans = false;
+
+	/** If set, every index written while saving is added here, so that tables filled from several threads
+	 * can be sorted afterwards (see SERecords::SortTables)
+	 */
+	TArray<FSETableFixup>* Fixups = nullptr;
+	/** Component record being written, or INDEX_NONE for the actor record */
+	int32 FixupComponent = INDEX_NONE;
+};
 
 
 /** Serializes world data */
 struct FSEArchive : public FObjectAndNameAsStringProxyArchive
 {
+protected:
+	FSEArchiveTables Tables;
+
 public:
-	FSEArchive(FArchive &InInnerArchive, bool bInLoadIfFindFails)
+	FSEArchive(FArchive &InInnerArchive, bool bInLoadIfFindFails, FSEArchiveTables InTables = {})
 		: FObjectAndNameAsStringProxyArchive(InInnerArchive,bInLoadIfFindFails)
+		, Tables(InTables)
 	{
 		ArIsSaveGame = true;
 		ArNoDelta = true;
 	}
 
+	virtual FArchive& operator<<(FName& Name) override;
 	virtual FArchive& operator<<(UObject*& Obj) override;
 };
@@ -0,0 +1,180 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <Hash/xxhash.h>
+#include <Misc/AES.h>
+#include <Serialization/Archive.h>
+
+
+enum class ESECompressionCodec : uint8;
+enum class ESECompressionLevel : uint8;
+
+/**
+ * Compresses data serialized into it in independent blocks. Filled blocks are compressed in parallel in
+ * batches and written to the inner archive in order, so memory usage is bound to one batch of blocks no matter
+ * how much data is written.
+ * If compression is disabled, data is forwarded to the inner archive as it is.
+ * If a dictionary is provided, blocks are compressed with zlib using it as their history instead of the codec.
+ * If a key is provided, blocks are also encrypted with AES in counter mode, in parallel together with their
+ * compression. Counters start from a random salt of the stream and the index of each block, and each block
+ * stores a tag (HMAC-SHA1) of its header and data, so a different key or modified blocks are detected.
+ */
+class SAVEEXTENSION_API FSEBlockWriter : public FArchive
+{
+public:
+	static constexpr int32 BlockSize = 256 * 1024;
+
+private:
+	FArchive& InnerArchive;
+	bool bCompress = true;
+	ESECompressionCodec Codec;
+	ESECompressionLevel Level;
+	TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> Dictionary;
+	TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> EncryptionKey;
+	uint64 Salt = 0;
+	// Key of the tags, derived from the encryption key
+	uint8 AuthKey[20]{};
+
+	TArray<uint8> Block;
+	// Filled blocks waiting to be compressed. Their memory is reused between batches
+	TArray<TArray<uint8>> PendingBlocks;
+	TArray<TArray<uint8>> CompressedBlocks;
+	TArray<int32> CompressedSizes;
+	int32 NumPendingBlocks = 0;
+	int32 NumWrittenBlocks = 0;
+	int32 BatchSize = 1;
+
+	// Raw position where the current block starts
+	int64 BlockOffset = 0;
+	int64 Position = 0;
+	int64 InnerStart = 0;
+
+	// Hash of the bytes written to the inner archive
+	FXxHash64Builder StoredHash;
+	bool bStoredHashValid = true;
+	// Hash of the bytes serialized into the writer
+	FXxHash64Builder RawHash;
+	bool bRawHashValid = true;
+
+
+public:
+	FSEBlockWriter(FArchive& InInnerArchive, bool bInCompress, ESECompressionCodec InCodec,
+		ESECompressionLevel InLevel, TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> InDictionary = {},
+		TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> InEncryptionKey = {});
+	virtual ~FSEBlockWriter() override;
+
+	virtual void Serialize(void* Data, int64 Num) override;
+	virtual int64 Tell() override
+	{
+		return Position;
+	}
+	virtual int64 TotalSize() override;
+	virtual void Seek(int64 InPos) override;
+	virtual bool Close() override;
+	virtual FString GetArchiveName() const override
+	{
+		return TEXT("FSEBlockWriter");
+	}
+
+	// @return number of blocks compressed in parallel
+	static int32 GetBatchSize();
+
+	/** @return hash of the bytes written to the inner archive, or 0 if it is unknown because uncompressed
+	 * data was patched after a seek. Valid after Close.
+	 */
+	uint64 GetStoredHash() const
+	{
+		return bStoredHashValid ? StoredHash.Finalize().Hash : 0;
+	}
+
+	/** @return hash of the bytes serialized before compression, or 0 if it is unknown because uncompressed
+	 * data was patched after a seek. Valid after Close.
+	 */
+	uint64 GetRawHash() const
+	{
+		return bRawHashValid ? RawHash.Finalize().Hash : 0;
+	}
+
+private:
+	void WriteInner(const void* Data, int64 Num);
+	void QueueBlock();
+	void FlushBlocks();
+};
+
+
+/**
+ * Reads data written by FSEBlockWriter, decrypting and decompressing batches of blocks in parallel.
+ * Blocks encrypted before they were authenticated are read with bInAuthenticated set to false.
+ */
+class SAVEEXTENSION_API FSEBlockReader : public FArchive
+{
+	FArchive& InnerArchive;
+	bool bCompressed = true;
+	ESECompressionCodec Codec;
+	TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> Dictionary;
+	TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> EncryptionKey;
+	bool bAuthenticated = true;
+	// Salt of the stream, read from its first block
+	uint64 Salt = 0;
+	uint8 AuthKey[20]{};
+	int64 RawSize = 0;
+
+	// Decompressed blocks of the current batch. Their memory is reused between batches
+	TArray<TArray<uint8>> Blocks;
+	TArray<TArray<uint8>> CompressedBlocks;
+	int32 NumBlocks = 0;
+	int32 CurrentBlock = INDEX_NONE;
+	int32 NumReadBlocks = 0;
+	int32 BatchSize = 1;
+
+	// Raw position where the current block starts
+	int64 BlockOffset = 0;
+	int64 Position = 0;
+	// Raw size of all blocks read from the inner archive
+	int64 RawRead = 0;
+	int64 InnerStart = 0;
+
+	// Hash of the bytes read from the inner archive
+	FXxHash64Builder StoredHash;
+	bool bStoredHashValid = true;
+
+
+public:
+	FSEBlockReader(FArchive& InInnerArchive, bool bInCompressed, ESECompressionCodec InCodec, int64 InRawSize,
+		TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> InDictionary = {},
+		TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> InEncryptionKey = {}, bool bInAuthenticated = true);
+
+	virtual void Serialize(void* Data, int64 Num) override;
+	virtual int64 Tell() override
+	{
+		return Position;
+	}
+	virtual int64 TotalSize() override
+	{
+		return RawSize;
+	}
+	virtual void Seek(int64 InPos) override;
+	virtual FString GetArchiveName() const override
+	{
+		return TEXT("FSEBlockReader");
+	}
+
+	/** @return hash of the bytes read from the inner archive, or 0 if it is unknown because of a seek.
+	 * Matches the hash of the writer once all data is read.
+	 */
+	uint64 GetStoredHash() const
+	{
+		return bStoredHashValid ? StoredHash.Finalize().Hash : 0;
+	}
+
+private:
+	int64 GetBlockEnd() const
+	{
+		return CurrentBlock >= 0 && CurrentBlock < NumBlocks ? BlockOffset + Blocks[CurrentBlock].Num() : BlockOffset;
+	}
+	void ReadInner(void* Data, int64 Num);
+	bool ReadBlock();
+	bool ReadBatch();
+};
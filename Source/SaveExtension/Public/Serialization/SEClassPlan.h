@@ -0,0 +1,54 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#pragma once
+
+#include <CoreMinimal.h>
+#include <UObject/UnrealType.h>
+
+
+/**
+ * SaveGame properties of a class, found once instead of walking every property of each object saved or
+ * loaded. Plans are cached by class and discarded when classes are hot reloaded or blueprints recompiled.
+ *
+ * An object is stored as the number of its properties, then the name, type hash and size of each property
+ * followed by its value. Properties added, removed or whose type changed since the file was saved are
+ * skipped when loading.
+ */
+struct SAVEEXTENSION_API FSEClassPlan
+{
+	struct FEntry
+	{
+		const FProperty* Property = nullptr;
+		FName Name;
+		/** Offset of the value inside the object */
+		int32 Offset = 0;
+		/** Hash of the C++ type and array size of the property */
+		uint32 TypeHash = 0;
+	};
+
+	TArray<FEntry> Entries;
+	/** Index of each entry by its name */
+	TMap<FName, int32> EntryIndices;
+
+	/** Primitive components only store their transform and tags */
+	bool bStoresData = true;
+
+
+	explicit FSEClassPlan(const UClass* Class);
+
+	/** Saves or loads the planned properties of Object */
+	void Serialize(FArchive& Ar, UObject* Object) const;
+
+	/** @return the plan of a class, building it the first time. Safe to use from any thread */
+	static TSharedRef<const FSEClassPlan, ESPMode::ThreadSafe> Get(const UClass* Class);
+
+	/** Discards all plans, so that they are built again from the current properties of their classes */
+	static void Reset();
+
+	/** Resets plans when classes are reloaded or reinstanced */
+	static void RegisterDelegates();
+	static void UnregisterDelegates();
+
+private:
+	void SerializeValue(FStructuredArchive::FStream& Stream, const FEntry& Entry, UObject* Object) const;
+};
@@ -28,6 +28,8 @@ enum class ELoadDataTaskState : uint8
 	NotStarted,
 
 	// Once loading starts we either load the map
+	// The file is read and verified before opening a different map, so that corrupted slots fail early
+	ReadingFile,
 	LoadingMap,
 	WaitingForData,
 
@@ -59,6 +61,8 @@ protected:
 	TArray<TWeakObjectPtr<AActor>> CurrentLevelActors;
 
 	UE::Tasks::TTask<USaveSlot*> LoadFileTask;
+	// Reads the records of loaded streaming levels that were left on disk
+	UE::Tasks::TTask<bool> LoadLevelsTask;
 
 	ELoadDataTaskState LoadState = ELoadDataTaskState::NotStarted;
 
@@ -83,11 +87,13 @@ public:
 
 private:
 	virtual void OnStart() override;
-
-	virtual void Tick(float DeltaTime) override;
 	virtual void OnFinish(bool bSuccess) override;
 
 	void StartDeserialization();
+	void OpenSlotMap();
+
+protected:
+	virtual void Tick(float DeltaTime) override;
 
 	/** Spawns Actors hat were saved but which actors are not in the world. */
 	void RespawnActors(const TArray<FActorRecord*>& Records, const ULevel* Level, FLevelRecord& LevelRecord);
@@ -96,6 +102,10 @@ protected:
 	void StartLoadingFile();
 	bool CheckFileLoaded();
 
+	/** Reads records of streaming levels that are still pending on disk */
+	void StartLoadingLevels(TArray<FName> LevelNames);
+	bool CheckLevelsLoaded() const;
+
 	/** BEGIN Deserialization */
 	void BeforeDeserialize();
 	void DeserializeSync();
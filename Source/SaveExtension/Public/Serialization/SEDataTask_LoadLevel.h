@@ -26,6 +26,9 @@ public:
 
 private:
 	virtual void OnStart() override;
+	virtual void Tick(float DeltaTime) override;
+
+	void StartLevelDeserialization();
 
 	virtual void DeserializeASyncLoop(float StartMS = 0.0f) override;
 };
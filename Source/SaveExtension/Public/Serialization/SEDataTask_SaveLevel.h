@@ -27,4 +27,7 @@ public:
 private:
 	virtual void OnStart() override;
 	virtual void OnFinish(bool bSuccess) override;
+
+	/** Moves records of hidden levels to disk once records take more memory than the slot allows */
+	void SpillLevels();
 };
@@ -0,0 +1,43 @@
+// Copyright 2015-2024 Piperift. All Rights Reserved.
+
+#pragma once
+
+#include <CoreMinimal.h>
+
+
+/**
+ * Transforms and velocities of the records of a level, stored as a column for each of their components instead
+ * of one record after another.
+ * Transforms can be quantized: positions relative to the bounds of the column, rotations as the three smallest
+ * components of their quaternion, and scales equal on all axes only once. Encoding and decoding run on vector
+ * registers, one transform at a time.
+ */
+struct SAVEEXTENSION_API FSETransformColumn
+{
+	static constexpr uint8 MaxPositionBits = 24;
+	static constexpr uint8 MaxRotationBits = 16;
+
+	/** Bits of each position component. If 0, transforms and velocities are stored without loss */
+	uint8 PositionBits = 0;
+	/** Bits of each of the three stored components of a rotation */
+	uint8 RotationBits = 0;
+
+	/** Transforms of actors and components in the order they are serialized */
+	TArray<FTransform> Transforms;
+	/** Velocities of each actor. Zero if not moving */
+	TArray<FVector> LinearVelocities;
+	TArray<FVector> AngularVelocities;
+
+
+	FSETransformColumn() = default;
+	FSETransformColumn(uint8 InPositionBits, uint8 InRotationBits)
+		: PositionBits(InPositionBits)
+		, RotationBits(InRotationBits)
+	{}
+
+	void Serialize(FArchive& Ar);
+
+private:
+	void SerializeQuantizedTransforms(FArchive& Ar);
+	void SerializeVelocities(FArchive& Ar);
+};
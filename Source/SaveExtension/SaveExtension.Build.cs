@@ -24,6 +24,9 @@ namespace UnrealBuildTool.Rules
 
 			PrivateDependencyModuleNames.AddRange(new string[] { });
 
+			// Compression dictionaries
+			AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
 			if (Target.Type == TargetType.Editor)
 			{
 				PrivateDependencyModuleNames.AddRange(new string[]
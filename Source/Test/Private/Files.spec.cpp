@@ -3,8 +3,22 @@
 #include "Automatron.h"
 #include "Helpers/TestActor.h"
 
+#include <HAL/FileManager.h>
+#include <HAL/PlatformFileManager.h>
+#include <Misc/FileHelper.h>
+#include <SECompressionDictionary.h>
 #include <SEFileHelpers.h>
+#include <SEPackFile.h>
+#include <SESlotCatalog.h>
 #include <SaveManager.h>
+#include <SaveSlot.h>
+#include <Serialization/LevelRecords.h>
+#include <Serialization/MemoryReader.h>
+#include <Serialization/MemoryWriter.h>
+#include <Serialization/SEBlockArchive.h>
+#include <Serialization/SEClassPlan.h>
+#include <Serialization/SETransformColumn.h>
+#include <Tasks/Pipe.h>
 
 
 class FSaveSpec_Files : public Automatron::FTestSpec
@@ -75,6 +89,640 @@ void FSaveSpec_Files::Define()
 		TestNotNull("Data is valid", Slot->GetData());
 	});
 
+	It("Loads streaming levels from files on demand", [this]() {
+		SaveManager->GetActiveSlot()->MultithreadedFiles = ESEAsyncMode::SaveAndLoadSync;
+
+		TestTrue("Saved", SaveManager->SaveSlot(0));
+
+		USaveSlot* Slot = FSEFileHelpers::LoadFileSync(TEXT("0"), nullptr, true, SaveManager);
+		TestNotNull("Slot is valid", Slot);
+		USaveSlotData* Data = Slot->GetData();
+		TestNotNull("Data is valid", Data);
+		TestFalse("Persistent level is loaded", Data->RootLevel.IsPending());
+		for (const FStreamingLevelRecord& Level : Data->SubLevels)
+		{
+			TestTrue("Streaming level is pending", Level.IsPending());
+		}
+	});
+
+	It("Catalogs saved slots", [this]() {
+		SaveManager->GetActiveSlot()->MultithreadedFiles = ESEAsyncMode::SaveAndLoadSync;
+
+		TestTrue("Saved", SaveManager->SaveSlot(0));
+
+		TArray<FSESlotCatalogEntry> Entries;
+		FSESlotCatalog::Get().GetEntries(Entries);
+		const FSESlotCatalogEntry* Entry = Entries.FindByPredicate([](const FSESlotCatalogEntry& Entry) {
+			return Entry.Name == TEXT("0");
+		});
+		TestNotNull("Slot is cataloged", Entry);
+		TestTrue("Catalog knows the slot", FSESlotCatalog::Get().Contains(TEXT("0")).Get(false));
+
+		TestTrue("Deleted", SaveManager->DeleteSlotByNameSync(TEXT("0")));
+		TestFalse("Catalog forgot the slot", FSESlotCatalog::Get().Contains(TEXT("0")).Get(true));
+	});
+
+	It("Detects corrupted files", [this]() {
+		SaveManager->GetActiveSlot()->MultithreadedFiles = ESEAsyncMode::SaveAndLoadSync;
+		TestTrue("Saved", SaveManager->SaveSlot(0));
+
+		const FString FilePath = FSEFileHelpers::GetSlotPath(TEXT("0"));
+		TestTrue("Saved file is valid", FSEFileHelpers::VerifyFileSync(FilePath));
+
+		TArray<uint8> FileBytes;
+		FFileHelper::LoadFileToArray(FileBytes, *FilePath);
+		FileBytes[FileBytes.Num() / 2] ^= 0xFF;
+		FFileHelper::SaveArrayToFile(FileBytes, *FilePath);
+		TestFalse("Corrupted file is detected", FSEFileHelpers::VerifyFileSync(FilePath));
+	});
+
+	It("Appends changes to a journal", [this]() {
+		USaveSlot* ActiveSlot = SaveManager->GetActiveSlot();
+		ActiveSlot->MultithreadedFiles = ESEAsyncMode::SaveAndLoadSync;
+		ActiveSlot->bUseJournal = true;
+		TestTrue("Saved base", SaveManager->SaveSlot(0));
+
+		const FString FilePath = FSEFileHelpers::GetSlotPath(TEXT("0"));
+		const FString JournalPath = FSEFileHelpers::GetJournalSlotPath(TEXT("0"));
+		const int64 BaseSize = IFileManager::Get().FileSize(*FilePath);
+		TestTrue("Saved journal", SaveManager->SaveSlot(0));
+		TestEqual("Base is unchanged", IFileManager::Get().FileSize(*FilePath), BaseSize);
+		TestTrue("Journal exists", IFileManager::Get().FileSize(*JournalPath) > 0);
+
+		USaveSlot* Slot = FSEFileHelpers::LoadFileSync(TEXT("0"), nullptr, true, SaveManager);
+		TestNotNull("Slot is valid", Slot);
+		TestNotNull("Data is valid", Slot ? Slot->GetData() : nullptr);
+
+		// Incomplete entries are ignored
+		TArray<uint8> JournalBytes;
+		FFileHelper::LoadFileToArray(JournalBytes, *JournalPath);
+		JournalBytes.SetNum(JournalBytes.Num() - 1, false);
+		FFileHelper::SaveArrayToFile(JournalBytes, *JournalPath);
+		TestNotNull("Base is recovered", FSEFileHelpers::LoadFileSync(TEXT("0"), nullptr, true, SaveManager));
+
+		ActiveSlot->bUseJournal = false;
+		TestTrue("Saved full file", SaveManager->SaveSlot(0));
+		TestTrue("Journal is discarded", IFileManager::Get().FileSize(*JournalPath) < 0);
+	});
+
+	It("Merges the journal into its file", [this]() {
+		USaveSlot* ActiveSlot = SaveManager->GetActiveSlot();
+		ActiveSlot->MultithreadedFiles = ESEAsyncMode::SaveAndLoadSync;
+		ActiveSlot->bUseJournal = true;
+		TestTrue("Saved base", SaveManager->SaveSlot(0));
+		TestTrue("Saved journal", SaveManager->SaveSlot(0));
+
+		const FString JournalPath = FSEFileHelpers::GetJournalSlotPath(TEXT("0"));
+		TestTrue("Compacted", FSEFileHelpers::CompactJournal(TEXT("0"), ESEFileDurability::None).GetResult());
+		TestTrue("Journal is discarded", IFileManager::Get().FileSize(*JournalPath) < 0);
+		TestTrue("File is valid", FSEFileHelpers::VerifyFileSync(FSEFileHelpers::GetSlotPath(TEXT("0"))));
+
+		USaveSlot* Slot = FSEFileHelpers::LoadFileSync(TEXT("0"), nullptr, true, SaveManager);
+		TestNotNull("Slot is valid", Slot);
+		TestNotNull("Data is valid", Slot ? Slot->GetData() : nullptr);
+	});
+
+	It("Saves deltas against the previous file", [this]() {
+		USaveSlot* ActiveSlot = SaveManager->GetActiveSlot();
+		ActiveSlot->MultithreadedFiles = ESEAsyncMode::SaveAndLoadSync;
+		ActiveSlot->bUseDeltaSaves = true;
+		ActiveSlot->MaxDeltaChain = 2;
+		TestTrue("Saved full file", SaveManager->SaveSlot(0));
+
+		const FString FilePath = FSEFileHelpers::GetSlotPath(TEXT("0"));
+		const FString BasePath = FilePath + TEXT(".base1");
+		TestTrue("Saved delta", SaveManager->SaveSlot(0));
+		TestTrue("Previous file is kept", IFileManager::Get().FileSize(*BasePath) > 0);
+		TestTrue("Delta is smaller", IFileManager::Get().FileSize(*FilePath) < IFileManager::Get().FileSize(*BasePath));
+		TestTrue("Delta is rebuilt", FSEFileHelpers::VerifyFileSync(FilePath));
+
+		USaveSlot* Slot = FSEFileHelpers::LoadFileSync(TEXT("0"), nullptr, true, SaveManager);
+		TestNotNull("Slot is valid", Slot);
+		TestNotNull("Data is valid", Slot ? Slot->GetData() : nullptr);
+
+		TestTrue("Saved second delta", SaveManager->SaveSlot(0));
+		TestTrue("Saved full file again", SaveManager->SaveSlot(0));
+		TestTrue("Previous files are deleted", IFileManager::Get().FileSize(*BasePath) < 0);
+	});
+
+	It("Shares level records between slots", [this]() {
+		USaveSlot* ActiveSlot = SaveManager->GetActiveSlot();
+		ActiveSlot->MultithreadedFiles = ESEAsyncMode::SaveAndLoadSync;
+		ActiveSlot->bUseBlobStore = true;
+		TestTrue("Saved first slot", SaveManager->SaveSlot(0));
+		TestTrue("Saved second slot", SaveManager->SaveSlot(1));
+
+		const FString BlobWildcard = FSEFileHelpers::GetSaveFolder() / TEXT("Blobs/*.blob");
+		TArray<FString> Blobs;
+		IFileManager::Get().FindFiles(Blobs, *BlobWildcard, true, false);
+		TestTrue("Records are stored as blobs", Blobs.Num() > 0);
+
+		USaveSlot* Slot = FSEFileHelpers::LoadFileSync(TEXT("1"), nullptr, true, SaveManager);
+		TestNotNull("Slot is valid", Slot);
+		TestNotNull("Data is valid", Slot ? Slot->GetData() : nullptr);
+
+		TestTrue("Deleted first slot", SaveManager->DeleteSlotByNameSync(TEXT("0")));
+		// Blobs are collected in the pipe
+		FSEFileHelpers::GetPipe().WaitUntilEmpty();
+		TArray<FString> SharedBlobs;
+		IFileManager::Get().FindFiles(SharedBlobs, *BlobWildcard, true, false);
+		TestTrue("Blobs of the second slot are kept", SharedBlobs.Num() > 0);
+		TestTrue("Second slot is still valid", FSEFileHelpers::VerifyFileSync(FSEFileHelpers::GetSlotPath(TEXT("1"))));
+
+		TestTrue("Deleted second slot", SaveManager->DeleteSlotByNameSync(TEXT("1")));
+		FSEFileHelpers::GetPipe().WaitUntilEmpty();
+		TArray<FString> UnusedBlobs;
+		IFileManager::Get().FindFiles(UnusedBlobs, *BlobWildcard, true, false);
+		TestEqual("Unused blobs are deleted", UnusedBlobs.Num(), 0);
+	});
+
+	It("Compresses data in blocks with every codec", [this]() {
+		TArray<uint8> Source;
+		Source.SetNumUninitialized(FSEBlockWriter::BlockSize * 3 + 17);
+		for (int32 I = 0; I < Source.Num(); ++I)
+		{
+			Source[I] = uint8(I % 7);
+		}
+
+		const UEnum* Codecs = StaticEnum<ESECompressionCodec>();
+		for (int32 Index = 0; Index < Codecs->NumEnums() - 1; ++Index)
+		{
+			const auto Codec = ESECompressionCodec(Codecs->GetValueByIndex(Index));
+			const FString CodecName = Codecs->GetNameStringByIndex(Index);
+
+			TArray<uint8> Stored;
+			{
+				FMemoryWriter StoredWriter(Stored);
+				FSEBlockWriter BlockWriter(StoredWriter, true, Codec, ESECompressionLevel::Fast);
+				BlockWriter.Serialize(Source.GetData(), Source.Num());
+				TestTrue(CodecName + " blocks written", BlockWriter.Close());
+				TestEqual(CodecName + " raw size", BlockWriter.TotalSize(), int64(Source.Num()));
+			}
+			TestTrue(CodecName + " data is compressed", Stored.Num() < Source.Num());
+
+			TArray<uint8> Result;
+			Result.SetNumUninitialized(Source.Num());
+			FMemoryReader StoredReader(Stored);
+			FSEBlockReader BlockReader(StoredReader, true, Codec, Source.Num());
+			BlockReader.Serialize(Result.GetData(), Result.Num());
+			TestFalse(CodecName + " blocks read", BlockReader.IsError());
+			TestTrue(CodecName + " data matches", Result == Source);
+		}
+	});
+
+	It("Compresses small levels with a trained dictionary", [this]() {
+		// Small levels sharing most of their content, like records of the same actors in different places
+		auto MakeLevel = [](int32 Seed) {
+			TArray<uint8> Level;
+			FMemoryWriter Writer(Level);
+			for (int32 i = 0; i < 24; ++i)
+			{
+				FString Name = FString::Printf(TEXT("/Game/Maps/Dungeon.Dungeon:PersistentLevel.BP_Torch_C_%i"), i);
+				FTransform Transform{FVector(Seed * 100.0, i * 50.0, 0.0)};
+				int32 Health = 100;
+				Writer << Name << Transform << Health;
+			}
+			return Level;
+		};
+		TArray<TArray<uint8>> Samples;
+		for (int32 Seed = 0; Seed < 32; ++Seed)
+		{
+			Samples.Add(MakeLevel(Seed));
+		}
+
+		auto* Dictionary = NewObject<USECompressionDictionary>();
+		TestTrue("Trained", Dictionary->Train(Samples));
+		TestTrue("Fits zlib history", Dictionary->GetBytes().Num() <= USECompressionDictionary::MaxSize);
+		auto DictionaryBytes = USECompressionDictionary::Find(Dictionary->GetId());
+		TestTrue("Registered", DictionaryBytes.IsValid());
+
+		const TArray<uint8> Source = MakeLevel(1000);
+		auto Compress = [&Source](TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> UsedDictionary) {
+			TArray<uint8> Stored;
+			FMemoryWriter StoredWriter(Stored);
+			FSEBlockWriter BlockWriter(
+				StoredWriter, true, ESECompressionCodec::Zlib, ESECompressionLevel::Fast, UsedDictionary);
+			BlockWriter.Serialize(const_cast<uint8*>(Source.GetData()), Source.Num());
+			BlockWriter.Close();
+			return Stored;
+		};
+		const TArray<uint8> Stored = Compress(DictionaryBytes);
+		TestTrue("Smaller with the dictionary", Stored.Num() < Compress({}).Num());
+
+		TArray<uint8> Result;
+		Result.SetNumUninitialized(Source.Num());
+		FMemoryReader StoredReader(Stored);
+		FSEBlockReader BlockReader(StoredReader, true, ESECompressionCodec::Zlib, Source.Num(), DictionaryBytes);
+		BlockReader.Serialize(Result.GetData(), Result.Num());
+		TestFalse("Blocks read", BlockReader.IsError());
+		TestTrue("Data matches", Result == Source);
+	});
+
+	It("Encrypts blocks with the key of the project", [this]() {
+		// Compressible blocks followed by random ones, which are stored as they are
+		TArray<uint8> Source;
+		Source.SetNumUninitialized(FSEBlockWriter::BlockSize * 4 + 33);
+		FRandomStream Random{7};
+		for (int32 i = 0; i < Source.Num(); ++i)
+		{
+			Source[i] = i < FSEBlockWriter::BlockSize * 2 ? uint8(i % 7) : uint8(Random.RandHelper(256));
+		}
+
+		auto MakeKey = [](uint8 Seed) {
+			FAES::FAESKey Key;
+			for (int32 i = 0; i < FAES::FAESKey::KeySize; ++i)
+			{
+				Key.Key[i] = uint8(Seed + i);
+			}
+			return MakeShared<const FAES::FAESKey, ESPMode::ThreadSafe>(Key);
+		};
+		const auto Key = MakeKey(1);
+
+		TArray<uint8> Stored;
+		{
+			FMemoryWriter StoredWriter(Stored);
+			FSEBlockWriter BlockWriter(
+				StoredWriter, true, ESECompressionCodec::Kraken, ESECompressionLevel::Fast, nullptr, Key);
+			BlockWriter.Serialize(Source.GetData(), Source.Num());
+			TestTrue("Blocks written", BlockWriter.Close());
+		}
+
+		auto Read = [&Stored, &Source](TSharedPtr<const FAES::FAESKey, ESPMode::ThreadSafe> ReadKey) {
+			TArray<uint8> Result;
+			Result.SetNumUninitialized(Source.Num());
+			FMemoryReader StoredReader(Stored);
+			FSEBlockReader BlockReader(
+				StoredReader, true, ESECompressionCodec::Kraken, Source.Num(), nullptr, MoveTemp(ReadKey));
+			BlockReader.Serialize(Result.GetData(), Result.Num());
+			return !BlockReader.IsError() && Result == Source;
+		};
+		TestTrue("Decrypted with the same key", Read(Key));
+		AddExpectedError(TEXT("Failed to authenticate blocks|Failed to decompress blocks|Found a corrupted block"),
+			EAutomationExpectedErrorFlags::Contains, 0);
+		TestFalse("Not readable with another key", Read(MakeKey(2)));
+		TestFalse("Not readable without a key", Read(nullptr));
+
+		// Random blocks are stored without compression. Changing them is only caught by their tag
+		Stored[Stored.Num() - 100] ^= 1;
+		TestFalse("Modified blocks rejected", Read(Key));
+
+		TArray<uint8> StoredAgain;
+		{
+			FMemoryWriter StoredWriter(StoredAgain);
+			FSEBlockWriter BlockWriter(
+				StoredWriter, true, ESECompressionCodec::Kraken, ESECompressionLevel::Fast, nullptr, Key);
+			BlockWriter.Serialize(Source.GetData(), Source.Num());
+			BlockWriter.Close();
+		}
+		TestTrue("Each stream is encrypted differently",
+			StoredAgain.Num() == Stored.Num() &&
+				FMemory::Memcmp(StoredAgain.GetData() + 8, Stored.GetData() + 8, 256) != 0);
+	});
+
+	It("Stores level names and classes in tables", [this]() {
+		FLevelRecord Level;
+		Level.Name = TEXT("TestLevel");
+		FActorRecord& Actor = Level.Actors.AddDefaulted_GetRef();
+		Actor.Name = TEXT("Actor_1");
+		Actor.Class = ATestActor::StaticClass();
+		Actor.Tags = {TEXT("TagA"), TEXT("TagB")};
+		Level.Actors.Add(Actor);
+
+		TArray<uint8> Stored;
+		{
+			FMemoryWriter Writer(Stored);
+			FObjectAndNameAsStringProxyArchive Ar(Writer, false);
+			TestTrue("Level saved", Level.SerializeWithTables(Ar));
+		}
+		// Level, actor, two tags and None for the empty level script
+		TestEqual("Each name is stored once", Level.Names.Num(), 5);
+		TestEqual("Each class is stored once", Level.Objects.Num(), 1);
+
+		FLevelRecord Loaded;
+		FMemoryReader Reader(Stored);
+		FSEArchive Ar(Reader, true);
+		TestTrue("Level loaded", Loaded.SerializeWithTables(Ar));
+		TestEqual("Level name", Loaded.Name, Level.Name);
+		TestEqual("Actors", Loaded.Actors.Num(), 2);
+		TestEqual("Actor name", Loaded.Actors[1].Name, Actor.Name);
+		TestTrue("Actor class", Loaded.Actors[1].Class == ATestActor::StaticClass());
+		TestTrue("Actor tags", Loaded.Actors[1].Tags == Actor.Tags);
+	});
+
+	It("Saves an unchanged world with the same bytes", [this]() {
+		USaveSlot* ActiveSlot = SaveManager->GetActiveSlot();
+		ActiveSlot->MultithreadedFiles = ESEAsyncMode::SaveAndLoadSync;
+		// Records are serialized in parallel, adding to the tables of their level in any order
+		ActiveSlot->MultithreadedSerialization = ESEAsyncMode::SaveAsync;
+		for (int32 i = 0; i < 64; ++i)
+		{
+			ATestActor* Actor = GetMainWorld()->SpawnActor<ATestActor>();
+			Actor->MyI32 = i;
+			Actor->Tags.Add(*FString::Printf(TEXT("Tag_%i"), i));
+		}
+
+		auto GetLevelHashes = []() {
+			TArray<uint64> Hashes;
+			FScopedFileReader Reader(FSEFileHelpers::GetSlotPath(TEXT("0")));
+			FSaveFile File;
+			File.Read(Reader, true);
+			for (const FSaveFileChunk& Chunk : File.Chunks)
+			{
+				if (Chunk.Type == ESaveFileChunkType::Level)
+				{
+					Hashes.Add(Chunk.Hash);
+				}
+			}
+			return Hashes;
+		};
+		TestTrue("Saved", SaveManager->SaveSlot(0));
+		const TArray<uint64> Hashes = GetLevelHashes();
+		TestTrue("Saved again", SaveManager->SaveSlot(0));
+		TestTrue("Levels are saved", !Hashes.IsEmpty());
+		TestTrue("Same level bytes", GetLevelHashes() == Hashes);
+	});
+
+	It("Stores identical record data once", [this]() {
+		TArray<uint8> SharedData;
+		SharedData.SetNumUninitialized(4096);
+		for (int32 i = 0; i < SharedData.Num(); ++i)
+		{
+			SharedData[i] = uint8(i * 7);
+		}
+
+		FLevelRecord Level;
+		Level.Name = TEXT("TestLevel");
+		for (int32 i = 0; i < 8; ++i)
+		{
+			FActorRecord& Actor = Level.Actors.AddDefaulted_GetRef();
+			Actor.Name = *FString::Printf(TEXT("Actor_%i"), i);
+			Actor.Class = ATestActor::StaticClass();
+			Actor.Data = SharedData;
+		}
+		Level.Actors.Last().Data.Last() = 1;
+
+		TArray<uint8> Stored;
+		{
+			FMemoryWriter Writer(Stored);
+			FObjectAndNameAsStringProxyArchive Ar(Writer, false);
+			TestTrue("Level saved", Level.SerializeWithTables(Ar));
+		}
+		TestTrue("Shared data is stored once", Stored.Num() < 3 * SharedData.Num());
+
+		FLevelRecord Loaded;
+		FMemoryReader Reader(Stored);
+		FSEArchive Ar(Reader, true);
+		TestTrue("Level loaded", Loaded.SerializeWithTables(Ar));
+		TestEqual("Actors", Loaded.Actors.Num(), Level.Actors.Num());
+		TestTrue("Shared data", TArray<uint8>{Loaded.Actors[0].GetData()} == SharedData);
+		TestTrue("Different data", TArray<uint8>{Loaded.Actors.Last().GetData()} == Level.Actors.Last().Data);
+	});
+
+	It("Restores the order of actors grouped by class", [this]() {
+		FLevelRecord Level;
+		Level.Name = TEXT("TestLevel");
+		Level.bGroupByClass = true;
+		for (int32 i = 0; i < 6; ++i)
+		{
+			FActorRecord& Actor = Level.Actors.AddDefaulted_GetRef();
+			Actor.Name = *FString::Printf(TEXT("Actor_%i"), i);
+			Actor.Class = i % 2 ? ATestActor::StaticClass() : AActor::StaticClass();
+			Actor.Transform.SetLocation({float(i), 0.f, 0.f});
+			Actor.Tags = {*FString::Printf(TEXT("Tag_%i"), i)};
+			Actor.Data = {uint8(i)};
+			FComponentRecord& Component = Actor.ComponentRecords.AddDefaulted_GetRef();
+			Component.Name = TEXT("Component");
+			Component.Class = USceneComponent::StaticClass();
+		}
+
+		TArray<uint8> Stored;
+		{
+			FMemoryWriter Writer(Stored);
+			FObjectAndNameAsStringProxyArchive Ar(Writer, false);
+			TestTrue("Level saved", Level.SerializeWithTables(Ar));
+		}
+
+		FLevelRecord Loaded;
+		FMemoryReader Reader(Stored);
+		FSEArchive Ar(Reader, true);
+		TestTrue("Level loaded", Loaded.SerializeWithTables(Ar));
+		TestTrue("Grouped by class", Loaded.bGroupByClass);
+		TestEqual("Actors", Loaded.Actors.Num(), Level.Actors.Num());
+		for (int32 i = 0; i < Level.Actors.Num(); ++i)
+		{
+			const FActorRecord& Actor = Loaded.Actors[i];
+			TestEqual("Actor order", Actor.Name, Level.Actors[i].Name);
+			TestTrue("Actor class", Actor.Class == Level.Actors[i].Class);
+			TestEqual("Actor location", Actor.Transform.GetLocation().X, double(i));
+			TestTrue("Actor tags", Actor.Tags == Level.Actors[i].Tags);
+			TestTrue("Actor data", TArray<uint8>{Actor.GetData()} == Level.Actors[i].Data);
+			TestEqual("Components", Actor.ComponentRecords.Num(), 1);
+		}
+	});
+
+	It("Reads grouped records as views into their level buffer", [this]() {
+		FLevelRecord Level;
+		Level.Name = TEXT("TestLevel");
+		Level.bGroupByClass = true;
+		for (int32 i = 0; i < 4; ++i)
+		{
+			FActorRecord& Actor = Level.Actors.AddDefaulted_GetRef();
+			Actor.Name = *FString::Printf(TEXT("Actor_%i"), i);
+			Actor.Class = ATestActor::StaticClass();
+			Actor.Data = {uint8(i), 2, 4, 8};
+		}
+
+		TArray64<uint8> Stored;
+		{
+			FMemoryWriter64 Writer(Stored);
+			FObjectAndNameAsStringProxyArchive Ar(Writer, false);
+			TestTrue("Level saved", Level.SerializeWithTables(Ar));
+		}
+
+		FLevelRecord Loaded;
+		SERecords::FDataViewScope ViewScope{Stored};
+		FMemoryReaderView Reader(MakeMemoryView(Stored));
+		FSEArchive Ar(Reader, true);
+		TestTrue("Level loaded", Loaded.SerializeWithTables(Ar));
+		TestEqual("Actors", Loaded.Actors.Num(), Level.Actors.Num());
+		const FActorRecord& Actor = Loaded.Actors[2];
+		TestTrue("Actor data", TArray<uint8>{Actor.GetData()} == Level.Actors[2].Data);
+		const uint8* Data = Actor.DataView.GetData();
+		TestTrue("Data points into the buffer",
+			Actor.Data.IsEmpty() && Data >= Stored.GetData() && Data < Stored.GetData() + Stored.Num());
+	});
+
+	It("Quantizes transform columns", [this]() {
+		FSETransformColumn Column{20, 15};
+		Column.Transforms.Add(FTransform::Identity);
+		Column.Transforms.Add(FTransform{FRotator{30.f, -60.f, 10.f}, FVector{-5000.0, 120.5, 42.0}, FVector{2.0}});
+		Column.Transforms.Add(FTransform{FRotator{-89.f, 170.f, 0.f}, FVector{8000.0, -300.0, 0.0}, {1.0, 2.0, 3.0}});
+		Column.LinearVelocities = {FVector::ZeroVector, FVector{100.0, 0.0, -980.0}};
+		Column.AngularVelocities = {FVector::ZeroVector, FVector::ZeroVector};
+
+		TArray<uint8> Stored;
+		FMemoryWriter Writer(Stored);
+		Column.Serialize(Writer);
+
+		FSETransformColumn Loaded;
+		FMemoryReader Reader(Stored);
+		Loaded.Serialize(Reader);
+		TestFalse("Column loaded", Reader.IsError());
+		TestEqual("Transforms", Loaded.Transforms.Num(), Column.Transforms.Num());
+		for (int32 i = 0; i < Column.Transforms.Num(); ++i)
+		{
+			const FTransform& Transform = Loaded.Transforms[i];
+			// 13km of bounds in 20 bits
+			TestTrue("Location", Transform.GetLocation().Equals(Column.Transforms[i].GetLocation(), 1.0));
+			TestTrue("Rotation", Transform.GetRotation().Equals(Column.Transforms[i].GetRotation(), 1e-3));
+			TestTrue("Scale", Transform.GetScale3D().Equals(Column.Transforms[i].GetScale3D()));
+		}
+		TestTrue("Velocity", Loaded.LinearVelocities[1].Equals(Column.LinearVelocities[1]));
+		TestTrue("Not moving", Loaded.LinearVelocities[0].IsZero());
+	});
+
+	It("References records of a level by index", [this]() {
+		ATestActor* SavedActor = GetMainWorld()->SpawnActor<ATestActor>();
+		FSEObjectTable Saved;
+		Saved.AddRecordObject(3, SavedActor);
+		const int32 Index = Saved.Add(SavedActor);
+
+		TArray<uint8> Stored;
+		FMemoryWriter Writer(Stored);
+		Saved.Serialize(Writer, true);
+
+		// Respawned with a different name
+		ATestActor* LoadedActor = GetMainWorld()->SpawnActor<ATestActor>();
+		FSEObjectTable Loaded;
+		FMemoryReader Reader(Stored);
+		Loaded.Serialize(Reader, true);
+		Loaded.AddRecordObject(3, LoadedActor);
+		TestTrue("Record resolved by index", Loaded.Resolve(Index, false) == LoadedActor);
+	});
+
+	It("Keeps files inside a pack", [this]() {
+		const FString Root = FPaths::ProjectSavedDir() / TEXT("PackTest");
+		const FString PackPath = Root / TEXT("Test.pack");
+		const FString Folder = Root / TEXT("Files");
+		IPlatformFile& LowerLevel = FPlatformFileManager::Get().GetPlatformFile();
+		IFileManager::Get().DeleteDirectory(*Root, false, true);
+
+		TArray<uint8> Bytes;
+		Bytes.SetNumUninitialized(64 * 1024);
+		for (int32 i = 0; i < Bytes.Num(); ++i)
+		{
+			Bytes[i] = uint8(i * 7);
+		}
+		{
+			FSEPackPlatformFile Pack{PackPath, Folder};
+			TestTrue("Pack created", Pack.Initialize(&LowerLevel, TEXT("")));
+			for (const TCHAR* Name : {TEXT("A.sav"), TEXT("B.sav"), TEXT("Blobs/C.blob")})
+			{
+				TUniquePtr<IFileHandle> Writer{Pack.OpenWrite(*(Folder / Name))};
+				TestTrue("Written", Writer && Writer->Write(Bytes.GetData(), Bytes.Num()));
+			}
+			TestFalse("Not a loose file", LowerLevel.FileExists(*(Folder / TEXT("A.sav"))));
+			TestTrue("Moved", Pack.MoveFile(*(Folder / TEXT("D.sav")), *(Folder / TEXT("B.sav"))));
+			TestTrue("Deleted", Pack.DeleteFile(*(Folder / TEXT("A.sav"))));
+
+			TArray<FString> Found;
+			Pack.IterateDirectory(*Folder, [&Found](const TCHAR* Path, bool bIsDirectory) {
+				Found.Add(FPaths::GetCleanFilename(Path));
+				return true;
+			});
+			Found.Sort();
+			TestTrue("Listed", Found == TArray<FString>{TEXT("Blobs"), TEXT("D.sav")});
+
+			{
+				TUniquePtr<IFileHandle> Appender{Pack.OpenWrite(*(Folder / TEXT("D.sav")), true)};
+				TestTrue("Appended", Appender && Appender->Write(Bytes.GetData(), Bytes.Num()));
+			}
+			TestEqual("Appended size", Pack.FileSize(*(Folder / TEXT("D.sav"))), int64(Bytes.Num()) * 2);
+
+			TestTrue("Defragmented", Pack.Defragment() > 0);
+			TestTrue("Compacted", Pack.GetFreeSpace() < Bytes.Num());
+		}
+
+		{
+			// Reopened from disk
+			FSEPackPlatformFile Pack{PackPath, Folder};
+			TestTrue("Pack opened", Pack.Initialize(&LowerLevel, TEXT("")));
+			TArray<uint8> Loaded;
+			Loaded.SetNumUninitialized(Bytes.Num());
+			TUniquePtr<IFileHandle> Reader{Pack.OpenRead(*(Folder / TEXT("Blobs/C.blob")))};
+			TestTrue("Read", Reader && Reader->Read(Loaded.GetData(), Loaded.Num()));
+			TestTrue("Same bytes", Loaded == Bytes);
+			TestFalse("Old name gone", Pack.FileExists(*(Folder / TEXT("B.sav"))));
+
+			Reader.Reset(Pack.OpenRead(*(Folder / TEXT("D.sav"))));
+			TestTrue("Read appended", Reader && Reader->Seek(Bytes.Num()) &&
+				Reader->Read(Loaded.GetData(), Loaded.Num()));
+			TestTrue("Same appended bytes", Loaded == Bytes);
+		}
+		IFileManager::Get().DeleteDirectory(*Root, false, true);
+	});
+
+	It("Spills records of hidden levels", [this]() {
+		USaveSlot* Slot = SaveManager->GetActiveSlot();
+		USaveSlotData* SlotData = Slot->GetData();
+		FStreamingLevelRecord& Level = SlotData->SubLevels.AddDefaulted_GetRef();
+		Level.Name = TEXT("SpilledLevel");
+		for (int32 i = 0; i < 4; ++i)
+		{
+			FActorRecord& Actor = Level.Actors.AddDefaulted_GetRef();
+			Actor.Name = *FString::Printf(TEXT("Actor_%i"), i);
+			Actor.Class = ATestActor::StaticClass();
+			Actor.Data = {uint8(i), 1, 2, 3};
+		}
+
+		const FName LevelName = Level.Name;
+		TestTrue("Spilled", FSEFileHelpers::SpillLevels(Slot, {LevelName}).GetResult());
+		FLevelRecord* Spilled = SlotData->FindLevelRecord(LevelName);
+		TestTrue("Records left memory", Spilled && Spilled->IsPending() && Spilled->Actors.IsEmpty());
+		const FString SpillPath = Spilled->PendingFile;
+		TestTrue("Spill file exists", IFileManager::Get().FileExists(*SpillPath));
+
+		TestTrue("Loaded", FSEFileHelpers::LoadLevelsSync(SlotData, {LevelName}));
+		FLevelRecord* Loaded = SlotData->FindLevelRecord(LevelName);
+		TestFalse("Not pending", Loaded->IsPending());
+		TestEqual("Actors", Loaded->Actors.Num(), 4);
+		TestEqual("Actor name", Loaded->Actors[3].Name, FName{TEXT("Actor_3")});
+		TestTrue("Actor data", TArray<uint8>{Loaded->Actors[3].GetData()} == TArray<uint8>{3, 1, 2, 3});
+		TestFalse("Spill file deleted", IFileManager::Get().FileExists(*SpillPath));
+	});
+
+	It("Serializes actor data with the plan of its class", [this]() {
+		const TSharedRef<const FSEClassPlan, ESPMode::ThreadSafe> Plan =
+			FSEClassPlan::Get(ATestActor::StaticClass());
+		TestTrue("Plan is cached", &*FSEClassPlan::Get(ATestActor::StaticClass()) == &*Plan);
+		TestTrue("Plans SaveGame properties", Plan->EntryIndices.Contains(TEXT("MyI32")));
+		TestFalse("Skips other properties", Plan->EntryIndices.Contains(TEXT("Tags")));
+
+		ATestActor* SavedActor = GetMainWorld()->SpawnActor<ATestActor>();
+		SavedActor->MyI32 = 42;
+		SavedActor->MyU64 = 7;
+		SavedActor->bMyBool = true;
+
+		FSENameTable Names;
+		FSEObjectTable Objects;
+		const FSEArchiveTables Tables{&Names, &Objects, true};
+		const FSEClassFilter ComponentFilter;
+		FActorRecord Record;
+		SERecords::SerializeActor(SavedActor, Record, ComponentFilter, Tables);
+		FActorRecord SerializedRecord;
+		SERecords::SerializeActor(SavedActor, SerializedRecord, ComponentFilter, {&Names, &Objects});
+		TestTrue("Smaller than Serialize", Record.Data.Num() < SerializedRecord.Data.Num());
+
+		ATestActor* LoadedActor = GetMainWorld()->SpawnActor<ATestActor>();
+		TestTrue("Loaded", SERecords::DeserializeActor(LoadedActor, Record, ComponentFilter, Tables));
+		TestEqual("Int", LoadedActor->MyI32, 42);
+		TestEqual("Unsigned", LoadedActor->MyU64, uint64(7));
+		TestTrue("Bool", LoadedActor->bMyBool);
+
+		FSEClassPlan::Reset();
+		TestTrue("Rebuilt after reset", &*FSEClassPlan::Get(ATestActor::StaticClass()) != &*Plan);
+	});
+
 	AfterEach([this]() {
 		if (SaveManager)
 		{